@@ -23,6 +23,10 @@
 #include <mozart/memory.hpp>
 #include <hexagon/ort.h>
 #include <vector>
+#include <string>
+#include <utility>
+#include <typeinfo>
+#include <unordered_map>
 #include <type_traits>
 #include <functional>
 #include <ostream>
@@ -400,10 +404,55 @@ namespace cs_impl {
 			}
 		};
 
+		// The object HVM code sees for a value in one runtime, reused every
+		// time the value crosses into that runtime for as long as the runtime
+		// keeps it alive. Methods bound to it are kept with the type they were
+		// bound for, as an assignment may swap in a value of another type.
+		struct hvm_object {
+			ort::Runtime *runtime;
+			any *owner;
+			HxOrtValue handle;
+			std::unordered_map<std::string, std::pair<const std::type_info *, HxOrtValue>> methods;
+		};
+
+		// Every instance has a runtime of its own, so a value has one object
+		// per runtime it has crossed into.
+		struct hvm_object_cache {
+			std::vector<hvm_object> objects;
+
+			hvm_object *find(const ort::Runtime *runtime)
+			{
+				for (auto &obj:objects)
+					if (obj.runtime == runtime)
+						return &obj;
+				return nullptr;
+			}
+
+			hvm_object *find_owner(const any *owner)
+			{
+				for (auto &obj:objects)
+					if (obj.owner == owner)
+						return &obj;
+				return nullptr;
+			}
+
+			// Called when a runtime collects the owner of an object.
+			void forget(const any *owner)
+			{
+				for (auto it = objects.begin(); it != objects.end(); ++it) {
+					if (it->owner == owner) {
+						objects.erase(it);
+						return;
+					}
+				}
+			}
+		};
+
 		struct proxy {
 			short protect_level = 0;
 			std::size_t refcount = 1;
 			baseHolder *data = nullptr;
+			hvm_object_cache *hvm_cache = nullptr;
 
 			proxy() = default;
 
@@ -415,6 +464,7 @@ namespace cs_impl {
 			{
 				if (data != nullptr)
 					data->kill();
+				delete hvm_cache;
 			}
 		};
 
@@ -529,13 +579,17 @@ namespace cs_impl {
 
 		~any()
 		{
+			if (mDat != nullptr && mDat->hvm_cache != nullptr)
+				mDat->hvm_cache->forget(this);
 			recycle();
 		}
 
 		static any wrap_hvm_value(const ort::Value& v);
 		static any from_hvm_value(const ort::Value& v);
 		ort::Value to_hvm_value();
-		virtual ort::Value Call(const std::vector<ort::Value>& args) override;
+		static ort::Value hvm_get_element(const ort::Value& target, const ort::Value& key);
+		static void hvm_set_element(const ort::Value& target, const ort::Value& key, const ort::Value& value);
+		virtual ort::Value Call(const ort::ArgumentList& args) override;
 		virtual ort::Value GetField(const char *name) override;
 
 		const std::type_info &type() const
@@ -316,4 +316,72 @@ namespace cs {
 			return c.mCni->clone();
 		}
 	};
+
+	// The object a native HVM method was bound to. Assignment swaps a value
+	// in place, so the type is checked again on every call rather than once
+	// at bind time.
+	template<typename T>
+	const var &hvm_bound_object(const var &self)
+	{
+		if (self.type() != typeid(T))
+			throw lang_error(std::string("Method of ") + cs_impl::get_name_of_type<T>() + " called on a value of another type.");
+		return self;
+	}
+
+	/*
+	* Native HVM implementations of the members array and list have in
+	* common: size, empty, front, back and the push/pop pair at both ends.
+	* Returns false if name is none of them.
+	*/
+	template<typename T>
+	bool bind_hvm_sequence_method(const var &self, const std::string &name, hexagon::ort::Runtime &rt, hexagon::ort::Value &method)
+	{
+		using hexagon::ort::Value;
+		var seq = self;
+		std::function<Value()> fn;
+		if (name == "size")
+			fn = [seq]() {
+				return Value::FromFloat(number(hvm_bound_object<T>(seq).template const_val<T>().size()));
+			};
+		else if (name == "empty")
+			fn = [seq]() {
+				return Value::FromBool(hvm_bound_object<T>(seq).template const_val<T>().empty());
+			};
+		else if (name == "front")
+			fn = [seq]() {
+				return var(hvm_bound_object<T>(seq).template const_val<T>().front()).to_hvm_value();
+			};
+		else if (name == "back")
+			fn = [seq]() {
+				return var(hvm_bound_object<T>(seq).template const_val<T>().back()).to_hvm_value();
+			};
+		else if (name == "push_back")
+			fn = [seq, &rt]() mutable {
+				hvm_bound_object<T>(seq);
+				seq.val<T>(true).push_back(copy(var::from_hvm_value(rt.GetArgument(0))));
+				return Value::Null();
+			};
+		else if (name == "push_front")
+			fn = [seq, &rt]() mutable {
+				hvm_bound_object<T>(seq);
+				seq.val<T>(true).push_front(copy(var::from_hvm_value(rt.GetArgument(0))));
+				return Value::Null();
+			};
+		else if (name == "pop_back")
+			fn = [seq]() mutable {
+				hvm_bound_object<T>(seq);
+				seq.val<T>(true).pop_back();
+				return Value::Null();
+			};
+		else if (name == "pop_front")
+			fn = [seq]() mutable {
+				hvm_bound_object<T>(seq);
+				seq.val<T>(true).pop_front();
+				return Value::Null();
+			};
+		else
+			return false;
+		method = hexagon::ort::Function::LoadNative(fn).Pin(rt);
+		return true;
+	}
 }
@@ -45,12 +45,14 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <cmath>
 #include <deque>
 #include <list>
 #include <map>
 // CovScript Headers
 #include <covscript/exceptions.hpp>
+#include <covscript/string_map.hpp>
 #include <covscript/any.hpp>
 #include <covscript/typedef.hpp>
 
@@ -89,6 +91,8 @@ namespace cs {
 	};
 
 // Callable and Function
+	class function;
+
 	class callable final {
 	public:
 		using function_type=std::function<var(vector &)>;
@@ -118,14 +122,33 @@ namespace cs {
 			return mType == types::member_fn;
 		}
 
+		// The script function this callable runs, or nullptr for native ones.
+		const function *get_function() const;
+
 		var call(vector &args) const
 		{
 			return mFunc(args);
 		}
 	};
 
+	// Tiered mode: how often a function ran in the interpreter, and the HVM
+	// code it was compiled to once it got hot. Copies of a function share
+	// it, so the count covers every callable made from one definition.
+	struct function_tier final {
+		enum class states {
+			interpreted, compiled, unsupported
+		};
+		states state = states::interpreted;
+		std::size_t hotness = 0;
+		HxOrtValue code;
+	};
+
 	class function final {
 		context_t mContext;
+		std::shared_ptr<function_tier> mTier;
+		// Filled in by get_inline_body.
+		mutable const cov::tree<token_base *> *mInlineBody = nullptr;
+		mutable bool mInlineChecked = false;
 	public:
 		std::vector<std::string> mArgs;
 		std::deque<statement_base *> mBody;
@@ -136,17 +159,36 @@ namespace cs {
 
 		function(context_t c, const std::vector<std::string> &args, const std::deque<statement_base *> &body)
 			: mContext(
-			      c), mArgs(args), mBody(body) {}
+			      c), mTier(std::make_shared<function_tier>()), mArgs(args), mBody(body) {}
 
 		~function() = default;
 
 		var call(vector &) const;
 
+		const context_t &get_context() const
+		{
+			return mContext;
+		}
+
+		const function_tier &get_tier() const
+		{
+			return *mTier;
+		}
+
 		var operator()(vector &args) const
 		{
 			return call(args);
 		}
 
+		// The expression of a body that is one small return statement
+		// without side effects, or nullptr. Calls to such a function can be
+		// replaced by the expression.
+		const cov::tree<token_base *> *get_inline_body() const;
+
+		// The inline body with the arguments of a call in place of the
+		// parameters, or an empty tree if the arguments cannot be inlined.
+		cov::tree<token_base *> inline_call(std::deque<cov::tree<token_base *>> &args) const;
+
 		void add_this()
 		{
 			std::vector<std::string> args{"this"};
@@ -161,6 +203,11 @@ namespace cs {
 		}
 	};
 
+	const function *callable::get_function() const
+	{
+		return mFunc.target<function>();
+	}
+
 	struct object_method final {
 		var object;
 		var callable;
@@ -267,6 +314,11 @@ namespace cs {
 			return mHash;
 		}
 
+		const std::deque<statement_base *> &get_method() const
+		{
+			return mMethod;
+		}
+
 		var operator()();
 	};
 
@@ -275,6 +327,8 @@ namespace cs {
 // Internal Garbage Collection
 	template<typename T>
 	class garbage_collector final {
+		// Packages may be lexed on worker threads
+		std::mutex lock;
 		std::forward_list<T *> table_new;
 		std::forward_list<T *> table_delete;
 	public:
@@ -292,11 +346,13 @@ namespace cs {
 
 		void add(void *ptr)
 		{
+			std::lock_guard<std::mutex> guard(lock);
 			table_new.push_front(static_cast<T *>(ptr));
 		}
 
 		void remove(void *ptr)
 		{
+			std::lock_guard<std::mutex> guard(lock);
 			table_delete.push_front(static_cast<T *>(ptr));
 		}
 	};
@@ -321,8 +377,37 @@ namespace cs {
 	std_exception_handler exception_handler::std_eh_callback = exception_handler::std_defalt_exception_handler;
 
 // Namespace and extensions
+// Populates one or more name spaces on their first access
+	class lazy_initializer final {
+		void (*m_func)();
+		bool m_done = false;
+	public:
+		lazy_initializer() = delete;
+
+		explicit lazy_initializer(void (*func)()) : m_func(func) {}
+
+		void operator()()
+		{
+			if (!m_done) {
+				m_done = true;
+				m_func();
+			}
+		}
+	};
+
 	class name_space final {
 		domain_t m_data;
+		mutable std::shared_ptr<lazy_initializer> m_init;
+
+		void prepare() const
+		{
+			if (m_init) {
+				std::shared_ptr<lazy_initializer> init;
+				std::swap(init, m_init);
+				(*init)();
+			}
+		}
+
 	public:
 		name_space() : m_data(std::make_shared<spp::sparse_hash_map<string, var >>()) {}
 
@@ -342,6 +427,7 @@ namespace cs {
 
 		var &get_var(const std::string &name)
 		{
+			prepare();
 			if (m_data->count(name) > 0)
 				return (*m_data)[name];
 			else
@@ -350,8 +436,14 @@ namespace cs {
 
 		domain_t get_domain() const
 		{
+			prepare();
 			return m_data;
 		}
+
+		void set_initializer(const std::shared_ptr<lazy_initializer> &init)
+		{
+			m_init = init;
+		}
 	};
 
 	class name_space_holder final {
@@ -467,6 +559,13 @@ namespace cs_impl {
 			cs::copy_no_return(it.second);
 	}
 
+	template<>
+	void detach<cs::string_map>(cs::string_map &val)
+	{
+		for (auto &it:val)
+			cs::copy_no_return(it.second);
+	}
+
 	template<>
 	std::string to_string<cs::number>(const cs::number &val)
 	{
@@ -550,6 +649,12 @@ namespace cs_impl {
 		return "cs::hash_map";
 	}
 
+	template<>
+	constexpr const char *get_name_of_type<cs::string_map>()
+	{
+		return "cs::string_map";
+	}
+
 	template<>
 	constexpr const char *get_name_of_type<cs::type>()
 	{
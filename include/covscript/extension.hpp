@@ -39,10 +39,12 @@ extern "C"
 		except_cs_ext::init();
 		char_cs_ext::init();
 		string_cs_ext::init();
+		string_builder_cs_ext::init();
 		list_cs_ext::init();
 		array_cs_ext::init();
 		pair_cs_ext::init();
 		hash_map_cs_ext::init();
+		string_map_cs_ext::init();
 		return cs_extension();
 	}
 }
@@ -168,6 +168,20 @@ namespace array_cs_ext {
 		return std::move(lst);
 	}
 
+// HVM
+	// at is the only array member bound natively that list lacks.
+	bool bind_hvm_method(const var &self, const std::string &name, ort::Runtime &rt, ort::Value &method)
+	{
+		if (name != "at")
+			return bind_hvm_sequence_method<array>(self, name, rt, method);
+		var arr = self;
+		std::function<ort::Value()> fn = [arr, &rt]() {
+			return at(hvm_bound_object<array>(arr).const_val<array>(), rt.GetArgument(0).ToF64()).to_hvm_value();
+		};
+		method = ort::Function::LoadNative(fn).Pin(rt);
+		return true;
+	}
+
 	void init()
 	{
 		array_ext.add_var("__new__", var::make_protect<callable>(cni(create), true));
@@ -23,12 +23,20 @@
 
 static cs::extension hash_map_ext;
 static cs::extension_t hash_map_ext_shared = cs::make_shared_extension(hash_map_ext);
+static cs::extension string_map_ext;
+static cs::extension_t string_map_ext_shared = cs::make_shared_extension(string_map_ext);
 namespace cs_impl {
 	template<>
 	cs::extension_t &get_ext<cs::hash_map>()
 	{
 		return hash_map_ext_shared;
 	}
+
+	template<>
+	cs::extension_t &get_ext<cs::string_map>()
+	{
+		return string_map_ext_shared;
+	}
 }
 namespace hash_map_cs_ext {
 	using namespace cs;
@@ -78,6 +86,47 @@ namespace hash_map_cs_ext {
 		return map.count(key) > 0;
 	}
 
+// HVM
+	// Lookups and updates called from HVM code go straight to the map
+	// instead of through cni; keys and values are converted per call.
+	bool bind_hvm_method(const var &self, const std::string &name, ort::Runtime &rt, ort::Value &method)
+	{
+		var map = self;
+		std::function<ort::Value()> fn;
+		if (name == "size")
+			fn = [map]() {
+				return ort::Value::FromFloat(size(hvm_bound_object<hash_map>(map).const_val<hash_map>()));
+			};
+		else if (name == "empty")
+			fn = [map]() {
+				return ort::Value::FromBool(empty(hvm_bound_object<hash_map>(map).const_val<hash_map>()));
+			};
+		else if (name == "exist")
+			fn = [map, &rt]() {
+				return ort::Value::FromBool(hvm_bound_object<hash_map>(map).const_val<hash_map>().count(var::from_hvm_value(rt.GetArgument(0))) > 0);
+			};
+		else if (name == "at")
+			fn = [map, &rt]() {
+				return var(hvm_bound_object<hash_map>(map).const_val<hash_map>().at(var::from_hvm_value(rt.GetArgument(0)))).to_hvm_value();
+			};
+		else if (name == "insert")
+			fn = [map, &rt]() mutable {
+				hvm_bound_object<hash_map>(map);
+				insert(map.val<hash_map>(true), var::from_hvm_value(rt.GetArgument(0)), var::from_hvm_value(rt.GetArgument(1)));
+				return ort::Value::Null();
+			};
+		else if (name == "erase")
+			fn = [map, &rt]() mutable {
+				hvm_bound_object<hash_map>(map);
+				erase(map.val<hash_map>(true), var::from_hvm_value(rt.GetArgument(0)));
+				return ort::Value::Null();
+			};
+		else
+			return false;
+		method = ort::Function::LoadNative(fn).Pin(rt);
+		return true;
+	}
+
 	void init()
 	{
 		hash_map_ext.add_var("__new__", var::make_protect<callable>(cni(create), true));
@@ -92,3 +141,75 @@ namespace hash_map_cs_ext {
 		hash_map_ext.add_var("exist", var::make_protect<callable>(cni(exist), true));
 	}
 }
+namespace string_map_cs_ext {
+	using namespace cs;
+
+	// A hash_map for string keys only: see cs_impl::basic_string_map.
+	const string &key_of(const var &key)
+	{
+		if (key.type() != typeid(string))
+			throw lang_error("Key of string_map must be a string.");
+		return key.const_val<string>();
+	}
+
+	string_map create()
+	{
+		return string_map();
+	}
+
+// Capacity
+	bool empty(const string_map &map)
+	{
+		return map.empty();
+	}
+
+	number size(const string_map &map)
+	{
+		return map.size();
+	}
+
+// Modifiers
+	void clear(string_map &map)
+	{
+		map.clear();
+	}
+
+	void insert(string_map &map, const var &key, const var &val)
+	{
+		auto result = map.emplace(key_of(key), var());
+		if (result.second)
+			result.first->second = copy(val);
+		else
+			result.first->second.swap(copy(val), true);
+	}
+
+	void erase(string_map &map, const var &key)
+	{
+		map.erase(key_of(key));
+	}
+
+// Lookup
+	var at(string_map &map, const var &key)
+	{
+		return map.at(key_of(key));
+	}
+
+	bool exist(string_map &map, const var &key)
+	{
+		return map.count(key_of(key)) > 0;
+	}
+
+	void init()
+	{
+		string_map_ext.add_var("__new__", var::make_protect<callable>(cni(create), true));
+		string_map_ext.add_var("__get__", var::make_protect<callable>(cni(at), true));
+		string_map_ext.add_var("__set__", var::make_protect<callable>(cni(insert), true));
+		string_map_ext.add_var("empty", var::make_protect<callable>(cni(empty), true));
+		string_map_ext.add_var("size", var::make_protect<callable>(cni(size), true));
+		string_map_ext.add_var("clear", var::make_protect<callable>(cni(clear), true));
+		string_map_ext.add_var("insert", var::make_protect<callable>(cni(insert), true));
+		string_map_ext.add_var("erase", var::make_protect<callable>(cni(erase), true));
+		string_map_ext.add_var("at", var::make_protect<callable>(cni(at), true));
+		string_map_ext.add_var("exist", var::make_protect<callable>(cni(exist), true));
+	}
+}
@@ -210,6 +210,52 @@ namespace ostream_cs_ext {
 		*out << val << std::endl;
 	}
 
+// HVM
+	void print_hvm_value(ostream &out, const ort::Value &val, ort::Runtime &rt)
+	{
+		if (val.Type() == ort::ValueType::Object && val.IsString(rt)) {
+			std::string buffer;
+			val.ReadString(rt, buffer);
+			*out << buffer;
+		}
+		else
+			*out << var::from_hvm_value(val);
+	}
+
+	// print and println write HVM strings without converting them to a var
+	// first; anything else is printed the way the cni versions print it.
+	bool bind_hvm_method(const var &self, const std::string &name, ort::Runtime &rt, ort::Value &method)
+	{
+		var out = self;
+		std::function<ort::Value()> fn;
+		if (name == "print")
+			fn = [out, &rt]() mutable {
+				hvm_bound_object<ostream>(out);
+				ostream &os = out.val<ostream>(true);
+				print_hvm_value(os, rt.GetArgument(0), rt);
+				*os << std::flush;
+				return ort::Value::Null();
+			};
+		else if (name == "println")
+			fn = [out, &rt]() mutable {
+				hvm_bound_object<ostream>(out);
+				ostream &os = out.val<ostream>(true);
+				print_hvm_value(os, rt.GetArgument(0), rt);
+				*os << std::endl;
+				return ort::Value::Null();
+			};
+		else if (name == "flush")
+			fn = [out]() mutable {
+				hvm_bound_object<ostream>(out);
+				flush(out.val<ostream>(true));
+				return ort::Value::Null();
+			};
+		else
+			return false;
+		method = ort::Function::LoadNative(fn).Pin(rt);
+		return true;
+	}
+
 	void init()
 	{
 		ostream_ext.add_var("put", var::make_protect<callable>(cni(put)));
@@ -148,6 +148,12 @@ namespace list_cs_ext {
 		lst.unique();
 	}
 
+// HVM
+	bool bind_hvm_method(const var &self, const std::string &name, ort::Runtime &rt, ort::Value &method)
+	{
+		return bind_hvm_sequence_method<list>(self, name, rt, method);
+	}
+
 	void init()
 	{
 		list_ext.add_var("iterator", var::make_protect<extension_t>(list_iterator_ext_shared));
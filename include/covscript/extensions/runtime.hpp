@@ -26,6 +26,7 @@
 #include <cstdlib>
 #include <hexagon/ort.h>
 #include <vector>
+#include <list>
 #include <unordered_map>
 #include <functional>
 
@@ -103,6 +104,97 @@ namespace runtime_cs_ext {
 		return val.hash();
 	}
 
+	// Result cache of a memoized function. Calls are keyed on their arguments,
+	// and once the cache is full the least recently used result is dropped.
+	class memo_cache final {
+		struct args_hash final {
+			std::size_t operator()(const vector &args) const
+			{
+				std::size_t seed = args.size();
+				for (auto &arg:args)
+					seed ^= arg.hash() + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+				return seed;
+			}
+		};
+
+		using entry_t=std::pair<vector, var>;
+		var m_func;
+		std::size_t m_capacity;
+		std::list<entry_t> m_entries;
+		std::unordered_map<vector, std::list<entry_t>::iterator, args_hash> m_index;
+	public:
+		memo_cache(const var &func, std::size_t capacity) : m_func(func), m_capacity(capacity) {}
+
+		var call(vector &args)
+		{
+			const callable &func = m_func.const_val<callable>();
+			decltype(m_index)::iterator it;
+			try {
+				it = m_index.find(args);
+			}
+			catch (const cov::error &) {
+				// Arguments without a hash are passed straight through.
+				return func.call(args);
+			}
+			if (it != m_index.end()) {
+				m_entries.splice(m_entries.begin(), m_entries, it->second);
+				return copy(it->second->second);
+			}
+			// The function may change its arguments, so the key is taken first.
+			vector key;
+			for (auto &arg:args)
+				key.push_back(copy(arg));
+			var result = func.call(args);
+			// A recursive call may have filled this entry in the meantime.
+			it = m_index.find(key);
+			if (it != m_index.end()) {
+				it->second->second = copy(result);
+				m_entries.splice(m_entries.begin(), m_entries, it->second);
+				return result;
+			}
+			if (m_entries.size() >= m_capacity) {
+				m_index.erase(m_entries.back().first);
+				m_entries.pop_back();
+			}
+			m_entries.emplace_front(key, copy(result));
+			m_index.emplace(std::move(key), m_entries.begin());
+			return result;
+		}
+	};
+
+	var memoize_bounded(const var &func, number capacity)
+	{
+		if (func.type() != typeid(callable) || func.const_val<callable>().is_member_fn())
+			throw lang_error("Only functions can be memoized.");
+		if (capacity < 1)
+			throw lang_error("Memoization cache must hold at least one result.");
+		auto cache = std::make_shared<memo_cache>(func, static_cast<std::size_t>(capacity));
+		return var::make_protect<callable>([cache](vector &args) -> var {
+			return cache->call(args);
+		});
+	}
+
+	var memoize(const var &func)
+	{
+		return memoize_bounded(func, 4096);
+	}
+
+	// How a script function runs in tiered mode (see --hvm-tiered):
+	// "interpreted", "compiled", or "unsupported" if it cannot be compiled.
+	string hvm_tier(const var &func)
+	{
+		if (func.type() != typeid(callable) || func.const_val<callable>().get_function() == nullptr)
+			throw lang_error("Only script functions are tiered.");
+		switch (func.const_val<callable>().get_function()->get_tier().state) {
+		case function_tier::states::compiled:
+			return "compiled";
+		case function_tier::states::unsupported:
+			return "unsupported";
+		default:
+			return "interpreted";
+		}
+	}
+
 	using expression_t=cov::tree<token_base *>;
 
 	var build(const context_t &context, const string &expr)
@@ -140,6 +232,9 @@ namespace runtime_cs_ext {
 		runtime_ext.add_var("randint", var::make_protect<callable>(cni(randint)));
 		runtime_ext.add_var("exception", var::make_protect<callable>(cni(exception)));
 		runtime_ext.add_var("hash", var::make_protect<callable>(cni(hash), true));
+		runtime_ext.add_var("memoize", var::make_protect<callable>(cni(memoize)));
+		runtime_ext.add_var("memoize_bounded", var::make_protect<callable>(cni(memoize_bounded)));
+		runtime_ext.add_var("hvm_tier", var::make_protect<callable>(cni(hvm_tier)));
 		runtime_ext.add_var("build", var::make_protect<callable>(cni(build)));
 		runtime_ext.add_var("solve", var::make_protect<callable>(cni(solve)));
 		runtime_ext.add_var("dynamic_import", var::make_protect<callable>(cni(dynamic_import), true));
@@ -160,6 +255,12 @@ public:
 	virtual void Init(ort::ObjectProxy& proxy) {
 		ort::Runtime& rt = *cs::get_active_runtime();
 
+		// Members without a native version below are called through cni,
+		// so `using runtime` finds every member of the extension.
+		for(auto& member : *cs::make_shared_extension(runtime_ext) -> get_domain()) {
+			cs::var value = member.second;
+			proxy.SetStaticField(member.first, value.to_hvm_value());
+		}
 		proxy.SetStaticField("time", ort::Function::LoadNative([&rt]() {
 			return ort::Value::FromFloat(runtime_cs_ext::time());
 		}).Pin(rt));
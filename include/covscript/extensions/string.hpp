@@ -22,14 +22,42 @@
 #include <covscript/cni.hpp>
 #include <cctype>
 
+namespace cs {
+	// Text that is built up piece by piece. Appending to it never copies
+	// what was appended before, unlike concatenating strings.
+	class string_builder final {
+	public:
+		std::string buffer;
+	};
+}
 static cs::extension string_ext;
 static cs::extension_t string_ext_shared = cs::make_shared_extension(string_ext);
+static cs::extension string_builder_ext;
+static cs::extension_t string_builder_ext_shared = cs::make_shared_extension(string_builder_ext);
 namespace cs_impl {
 	template<>
 	cs::extension_t &get_ext<cs::string>()
 	{
 		return string_ext_shared;
 	}
+
+	template<>
+	cs::extension_t &get_ext<cs::string_builder>()
+	{
+		return string_builder_ext_shared;
+	}
+
+	template<>
+	constexpr const char *get_name_of_type<cs::string_builder>()
+	{
+		return "cs::string_builder";
+	}
+
+	template<>
+	std::string to_string<cs::string_builder>(const cs::string_builder &sb)
+	{
+		return sb.buffer;
+	}
 }
 namespace string_cs_ext {
 	using namespace cs;
@@ -173,3 +201,54 @@ namespace string_cs_ext {
 		string_ext.add_var("split", var::make_protect<callable>(cni(split), true));
 	}
 }
+namespace string_builder_cs_ext {
+	using namespace cs;
+
+	string_builder create()
+	{
+		return string_builder();
+	}
+
+	// Returns the builder itself, so calls can be chained.
+	var append(var &sb, const var &val)
+	{
+		sb.val<string_builder>(true).buffer.append(val.to_string());
+		return sb;
+	}
+
+	void reserve(string_builder &sb, number size)
+	{
+		sb.buffer.reserve(size);
+	}
+
+	string to_string(const string_builder &sb)
+	{
+		return sb.buffer;
+	}
+
+	bool empty(const string_builder &sb)
+	{
+		return sb.buffer.empty();
+	}
+
+	number size(const string_builder &sb)
+	{
+		return sb.buffer.size();
+	}
+
+	void clear(string_builder &sb)
+	{
+		sb.buffer.clear();
+	}
+
+	void init()
+	{
+		string_builder_ext.add_var("__new__", var::make_protect<callable>(cni(create), true));
+		string_builder_ext.add_var("append", var::make_protect<callable>(cni(append), true));
+		string_builder_ext.add_var("reserve", var::make_protect<callable>(cni(reserve), true));
+		string_builder_ext.add_var("to_string", var::make_protect<callable>(cni(to_string), true));
+		string_builder_ext.add_var("empty", var::make_protect<callable>(cni(empty), true));
+		string_builder_ext.add_var("size", var::make_protect<callable>(cni(size), true));
+		string_builder_ext.add_var("clear", var::make_protect<callable>(cni(clear), true));
+	}
+}
@@ -21,6 +21,8 @@
 */
 #include <covscript/symbols.hpp>
 #include <covscript/runtime.hpp>
+#include <future>
+#include <thread>
 
 namespace cs {
 	class translator_type final {
@@ -266,6 +268,8 @@ namespace cs {
 		void init_runtime_no_vm();
 		void init_runtime_with_vm();
 
+		bool hvm_tier_initialized = false;
+
 	public:
 		// Context
 		context_t context;
@@ -273,6 +277,14 @@ namespace cs {
 		bool enable_hvm;
 		bool enable_hvm_optimization;
 
+		// Tiered mode: run in the interpreter and compile a function to HVM
+		// code once its calls plus the loop iterations run in its body reach
+		// hvm_tier_threshold.
+		bool enable_hvm_tiering = false;
+		bool hvm_tier_debug = false;
+		std::size_t hvm_tier_threshold = 1000;
+		std::size_t loop_back_edges = 0;
+
 		// Constructor and destructor
 		instance_type(bool _enable_hvm = false) : context(std::make_shared<context_type>(this))
 		{
@@ -297,7 +309,19 @@ namespace cs {
 		bool break_block = false;
 		bool continue_block = false;
 		// Refers
-		std::forward_list<instance_type> refers;
+		std::forward_list<std::shared_ptr<instance_type>> refers;
+		// Packages being lexed on worker threads, keyed by file path
+		struct package_prefetch {
+			std::shared_ptr<instance_type> instance;
+			std::string path;
+			std::deque<token_base *> tokens;
+			std::promise<void> lexed;
+			std::future<void> ready;
+		};
+
+		class package_prefetcher;
+
+		std::unordered_map<std::string, package_prefetch *> prefetched;
 		// Function Stack
 		cov::static_stack<var, fcall_stack_size> fcall_stack;
 		// Var definition
@@ -391,13 +415,31 @@ namespace cs {
 		extension_t import(const std::string &, const std::string &);
 
 		// Wrapped Method
+		void lex(const std::string &, std::deque<token_base *> &);
+
+		void parse(std::deque<token_base *> &);
+
 		void compile(const std::string &);
 
 		void run(bool debug, bool compile_only);
 
 		void interpret();
 
+		// Embedding API: compile a file or a string, interpret() the top-level statements once,
+		// then invoke() global functions as often as needed. Extensions must be initialized first.
+		void compile_string(const std::string &, const std::string & = "<string>");
+
+		var invoke(const std::string &, vector &);
+
+		void reset();
+
 		void run_in_hexagon_vm(bool debug, bool compile_only);
+
+		// Tiered mode: compile a hot function, or mark it as unsupported if
+		// its body cannot be compiled.
+		void tier_up(const std::vector<std::string> &, const std::deque<statement_base *> &, function_tier &);
+
+		var call_tiered(const function_tier &, vector &);
 	};
 
 // Repl
@@ -476,4 +518,21 @@ namespace cs {
 			return context->instance->fcall_stack.top();
 		}
 	};
+
+	// Charges the loop iterations run during an interpreted call to the
+	// function being called (see instance_type::enable_hvm_tiering).
+	class back_edge_guard final {
+		context_t context;
+		function_tier &tier;
+		std::size_t start;
+	public:
+		back_edge_guard() = delete;
+
+		back_edge_guard(context_t c, function_tier &t) : context(c), tier(t), start(c->instance->loop_back_edges) {}
+
+		~back_edge_guard()
+		{
+			tier.hotness += context->instance->loop_back_edges - start;
+		}
+	};
 }
@@ -23,6 +23,8 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <stdexcept>
@@ -92,6 +94,14 @@ namespace cs {
 			m_data.front()->clear();
 		}
 
+		void clear_local_domains()
+		{
+			while (m_set.size() > 1)
+				m_set.pop_front();
+			while (m_data.size() > 1)
+				m_data.pop_front();
+		}
+
 		bool exist_record(const string &name)
 		{
 			return m_set.front().count(name) > 0;
@@ -234,6 +244,16 @@ namespace cs {
 	public:
 		std::unordered_map<std::string, std::pair<hexagon::ort::Value, bool /* escalated */>> globals;
 
+		// Names in the global environment that are bound before the entry
+		// point runs, and names that code may assign to at runtime. Only
+		// the former minus the latter can be cached by compiled functions.
+		std::unordered_set<std::string> fixed_globals;
+		std::unordered_set<std::string> mutable_globals;
+
+		bool is_fixed(const std::string& name) const {
+			return mutable_globals.count(name) == 0 && (globals.count(name) || fixed_globals.count(name));
+		}
+
 		void add(const std::string& k, const hexagon::ort::Value& v, bool escalated = false) {
 			globals.insert(std::make_pair(k, std::make_pair(v, escalated)));
 			if(IsInitialized()) {
@@ -252,6 +272,98 @@ namespace cs {
 		}
 	};
 
+	// Exposes an extension to HVM code with every member as a static field,
+	// so member lookups are resolved by the HVM without calling back into
+	// the extension.
+	class extension_hvm_impl : public hexagon::ort::ProxiedObject {
+		extension_t ext;
+	public:
+		explicit extension_hvm_impl(const extension_t& e) : ext(e) {}
+
+		virtual void Init(hexagon::ort::ObjectProxy& proxy) override {
+			for(auto& member : *ext -> get_domain()) {
+				var value = member.second;
+				proxy.SetStaticField(member.first, value.to_hvm_value());
+			}
+			proxy.Freeze();
+		}
+	};
+
+	// Case lookup for a switch statement compiled to HVM code. Maps the value
+	// being switched on to the index of the case to run, or -1 when no case
+	// matches. Keys keep their type, so a char case never matches a number
+	// (see cs_switch_index for how HVM values are tagged). If every key is
+	// an integer of one type in a small range, the lookup is a table index
+	// instead of a hash.
+	class switch_table {
+		std::vector<long long> dense;
+		long long dense_base = 0;
+		bool is_dense = false;
+		bool dense_chars = false;
+		spp::sparse_hash_map<var, long long> hashed;
+
+		static bool as_integer(const var& key, bool chars, long long& out) {
+			if(chars) {
+				if(key.type() != typeid(char)) {
+					return false;
+				}
+				out = key.const_val<char>();
+				return true;
+			}
+			if(key.type() != typeid(number)) {
+				return false;
+			}
+			number v = key.const_val<number>();
+			if(v < -1e15 || v > 1e15 || (number)(long long) v != v) {
+				return false;
+			}
+			out = (long long) v;
+			return true;
+		}
+
+	public:
+		explicit switch_table(const std::vector<var>& keys) {
+			bool chars = !keys.empty() && keys.front().type() == typeid(char);
+			std::vector<long long> ints;
+			for(auto& key : keys) {
+				long long i;
+				if(!as_integer(key, chars, i)) {
+					break;
+				}
+				ints.push_back(i);
+			}
+			if(!ints.empty() && ints.size() == keys.size()) {
+				long long lo = *std::min_element(ints.begin(), ints.end());
+				long long hi = *std::max_element(ints.begin(), ints.end());
+				if(hi - lo < 4 * (long long) keys.size() + 16) {
+					is_dense = true;
+					dense_chars = chars;
+					dense_base = lo;
+					dense.assign(hi - lo + 1, -1);
+					for(std::size_t i = 0; i < ints.size(); i++) {
+						dense[ints[i] - lo] = i;
+					}
+					return;
+				}
+			}
+			for(std::size_t i = 0; i < keys.size(); i++) {
+				hashed.emplace(keys[i], i);
+			}
+		}
+
+		long long find(const var& key) const {
+			if(is_dense) {
+				long long i;
+				if(!as_integer(key, dense_chars, i) || i < dense_base || i - dense_base >= (long long) dense.size()) {
+					return -1;
+				}
+				return dense[i - dense_base];
+			}
+			auto it = hashed.find(key);
+			return it == hashed.end() ? -1 : it -> second;
+		}
+	};
+
 	class function_builder {
 	public:
 		function_builder *parent;
@@ -262,13 +374,41 @@ namespace cs {
 		int next_local_id;
 		std::vector<std::string> arg_names;
 		std::vector<std::pair<int, int>> loop_control_target_blocks; // (continue, break)
+		std::vector<std::pair<int, int>> try_handlers; // (catch block, exception local)
 		int current;
 
+		// Methods of structs and namespaces are not bound to the global
+		// environment: they see the object they are called on as `this`
+		// and reach globals through its prototype chain.
+		bool bind_this;
+
+		// Member names of the namespaces defined so far, and the extensions
+		// in the global registry, kept by the entry function builder for
+		// `using` statements.
+		std::unordered_map<std::string, std::vector<std::string>> namespace_members;
+		std::unordered_map<std::string, name_space_t> extensions;
+
+		// Functions defined in the entry function, with the local they are
+		// stored in, for inlining calls to them. Null if the name is defined
+		// more than once.
+		std::unordered_map<std::string, std::pair<const function *, int>> inline_functions;
+
+		// Locals the arguments are stored in, see map_arg_names.
+		std::vector<long long> arg_locals;
+
+		// Set on the root builder when the code stores to an argument or
+		// uses try or throw. The interpreter passes arguments by reference
+		// and catches exceptions as lang_error, so tiered mode leaves such
+		// functions interpreted (see instance_type::tier_up).
+		bool stores_arguments = false;
+		bool uses_exceptions = false;
+
 		function_builder(const function_builder& other) = delete;
 		function_builder(function_builder&& other) = delete;
 
 		function_builder() {
 			parent = nullptr;
+			bind_this = true;
 
 			vars.push_back(var_scope_impl());
 			next_local_id = 0;
@@ -285,6 +425,14 @@ namespace cs {
 			return *blocks.at(current);
 		}
 
+		function_builder& root() {
+			function_builder *b = this;
+			while(b -> parent != nullptr) {
+				b = b -> parent;
+			}
+			return *b;
+		}
+
 		function_builder& create_child(const std::string& name) {
 			std::unique_ptr<function_builder> child = std::unique_ptr<function_builder>(new function_builder());
 			child -> parent = this;
@@ -317,6 +465,34 @@ namespace cs {
 			return loop_control_target_blocks[loop_control_target_blocks.size() - 1];
 		}
 
+		void push_try_handler(int catch_block, int exception_local) {
+			try_handlers.push_back(std::make_pair(catch_block, exception_local));
+		}
+
+		void pop_try_handler() {
+			try_handlers.pop_back();
+		}
+
+		// Returns false if no try statement in this function encloses the
+		// current position.
+		bool get_try_handler(std::pair<int, int>& out) const {
+			if(try_handlers.empty()) {
+				return false;
+			}
+			out = try_handlers.back();
+			return true;
+		}
+
+		// Only throw statements reach the catch block of a try compiled to
+		// HVM code. Code in a try body that may throw in any other way, such
+		// as a call or an element access, calls this to give up on compiling
+		// the function, so it runs in the interpreter instead.
+		void check_throw_free() const {
+			if(!try_handlers.empty()) {
+				throw internal_error("Code generation for operations that may throw inside try is not implemented");
+			}
+		}
+
 		// expected stack state: ... args* target
 		void complete_call(int n_args) {
 			using namespace hexagon::assembly_writer;
@@ -328,20 +504,20 @@ namespace cs {
 			}
 
 			BytecodeOp& last = current.opcodes[current.opcodes.size() - 1];
-			if(last.name == "GetField") {
+			if(last.opcode == Opcode::GetField) {
 				// original: ... key obj -> ... field
 				// expected: ... key this obj -> ... ret
-				last = BytecodeOp("LoadNull");
+				// The object the field is read from is passed as `this`,
+				// which is what methods compiled with bind_this == false see.
+				last = BytecodeOp(Opcode::Dup);
 
 				// last is NOT safe to use any more after this!
-				current
-					.Write(BytecodeOp("Rotate2"))
-					.Write(BytecodeOp("CallField", Operand::I64(n_args)));
+				current.Write(BytecodeOp(Opcode::CallField, Operand::I64(n_args)));
 			} else {
 				current
-					.Write(BytecodeOp("LoadNull"))
-					.Write(BytecodeOp("Rotate2"))
-					.Write(BytecodeOp("Call", Operand::I64(n_args)));
+					.Write(BytecodeOp(Opcode::LoadNull))
+					.Write(BytecodeOp(Opcode::Rotate2))
+					.Write(BytecodeOp(Opcode::Call, Operand::I64(n_args)));
 			}
 		}
 
@@ -357,47 +533,44 @@ namespace cs {
 			int last_id = current.opcodes.size() - 1;
 			BytecodeOp last = current.opcodes[last_id];
 
-			if(last.name == "GetLocal") {
+			if(last.opcode == Opcode::GetLocal) {
 				// original: ... -> ... [b] (Pushes the value onto stack)
 				// new: ... -> ... (Moves the value on stack to local)
 				modifier();
 
-				Operand local_id = last.operands.at(0);
-				current.opcodes.push_back(BytecodeOp("SetLocal", local_id));
-			} else if(last.name == "GetArrayElement") {
+				Operand local_id = last.operands[0];
+				note_local_store(local_id.i64_value);
+				current.opcodes.push_back(BytecodeOp(Opcode::SetLocal, local_id));
+			} else if(last.opcode == Opcode::GetArrayElement) {
 				// original: ... a key obj -> a [b]
 				// new: ... a key obj -> ... a
-				current.opcodes[last_id] = BytecodeOp("Rotate2"); // (a, obj, key)
-				current.opcodes.push_back(BytecodeOp("Dup")); // (a, obj, key, key)
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, key, key, obj)
-				current.opcodes.push_back(BytecodeOp("Dup")); // (a, key, key, obj, obj)
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, key, obj, obj, key)
-				current.opcodes.push_back(BytecodeOp("Rotate2")); // (a, key, obj, key, obj)
-				current.opcodes.push_back(last); // (a, key, obj, item)
-
-				modifier(); // (a, key, obj, v)
-
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, obj, v, key)
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, v, key, obj)
-				current.opcodes.push_back(BytecodeOp("SetArrayElement")); // (a)
-			} else if(last.name == "GetField") {
+				current.opcodes[last_id] = BytecodeOp(Opcode::Dup); // (a, key, obj, obj)
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate3)); // (a, obj, obj, key)
+				current.opcodes.push_back(BytecodeOp(Opcode::Dup)); // (a, obj, obj, key, key)
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate3)); // (a, obj, key, key, obj)
+				current.opcodes.push_back(last); // (a, obj, key, item)
+
+				modifier(); // (a, obj, key, v)
+
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate2)); // (a, obj, v, key)
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate3)); // (a, v, key, obj)
+				current.opcodes.push_back(BytecodeOp(Opcode::SetArrayElement)); // (a)
+			} else if(last.opcode == Opcode::GetField) {
 				// original: ... a key obj -> a [b]
 				// new: ... a key obj -> ... a
-				current.opcodes[last_id] = BytecodeOp("Rotate2"); // (a, obj, key)
-				current.opcodes.push_back(BytecodeOp("Dup")); // (a, obj, key, key)
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, key, key, obj)
-				current.opcodes.push_back(BytecodeOp("Dup")); // (a, key, key, obj, obj)
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, key, obj, obj, key)
-				current.opcodes.push_back(BytecodeOp("Rotate2")); // (a, key, obj, key, obj)
-				current.opcodes.push_back(last); // (a, key, obj, item)
-
-				modifier(); // (a, key, obj, v)
-
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, obj, v, key)
-				current.opcodes.push_back(BytecodeOp("Rotate3")); // (a, v, key, obj)
-				current.opcodes.push_back(BytecodeOp("SetField")); // (a)
+				current.opcodes[last_id] = BytecodeOp(Opcode::Dup); // (a, key, obj, obj)
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate3)); // (a, obj, obj, key)
+				current.opcodes.push_back(BytecodeOp(Opcode::Dup)); // (a, obj, obj, key, key)
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate3)); // (a, obj, key, key, obj)
+				current.opcodes.push_back(last); // (a, obj, key, item)
+
+				modifier(); // (a, obj, key, v)
+
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate2)); // (a, obj, v, key)
+				current.opcodes.push_back(BytecodeOp(Opcode::Rotate3)); // (a, v, key, obj)
+				current.opcodes.push_back(BytecodeOp(Opcode::SetField)); // (a)
 			} else {
-				throw internal_error(std::string("Transformation not implemented: ") + last.name);
+				throw internal_error(std::string("Transformation not implemented: ") + last.Name());
 			}
 		}
 
@@ -411,21 +584,22 @@ namespace cs {
 			}
 
 			BytecodeOp& last = current.opcodes[current.opcodes.size() - 1];
-			if(last.name == "GetLocal") {
+			if(last.opcode == Opcode::GetLocal) {
 				// original: ... a -> ... a [b] (Pushes the value onto stack)
 				// new: ... a -> ... (Moves the value on stack to local)
-				Operand local_id = last.operands.at(0);
-				last = BytecodeOp("SetLocal", local_id);
-			} else if(last.name == "GetArrayElement") {
+				Operand local_id = last.operands[0];
+				note_local_store(local_id.i64_value);
+				last = BytecodeOp(Opcode::SetLocal, local_id);
+			} else if(last.opcode == Opcode::GetArrayElement) {
 				// original: ... a id arr -> ... a [b]
 				// new: ... a id arr -> ...
-				last = BytecodeOp("SetArrayElement");
-			} else if(last.name == "GetField") {
+				last = BytecodeOp(Opcode::SetArrayElement);
+			} else if(last.opcode == Opcode::GetField) {
 				// original: ... a key obj -> a [b]
 				// new: ... a key obj -> ...
-				last = BytecodeOp("SetField");
+				last = BytecodeOp(Opcode::SetField);
 			} else {
-				throw internal_error(std::string("Transformation not implemented: ") + last.name);
+				throw internal_error(std::string("Transformation not implemented: ") + last.Name());
 			}
 		}
 
@@ -436,20 +610,286 @@ namespace cs {
 			// pushes: element
 
 			get_current()
-				.Write(BytecodeOp("LoadThis"))
-				.Write(BytecodeOp("GetField"));
+				.Write(BytecodeOp(Opcode::LoadThis))
+				.Write(BytecodeOp(Opcode::GetField));
+		}
+
+		// pops: value
+		// At the top level of the entry function, names defined by struct,
+		// namespace and using statements are bound in the global environment
+		// so that functions can see them; anywhere else they are locals like
+		// variables.
+		void write_bind_name(const std::string& name) {
+			using namespace hexagon::assembly_writer;
+
+			if(parent == nullptr && vars.size() == 1) {
+				get_current()
+					.Write(BytecodeOp(Opcode::LoadString, Operand::String(name)))
+					.Write(BytecodeOp(Opcode::LoadThis))
+					.Write(BytecodeOp(Opcode::SetField));
+			} else {
+				get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(map_local(name))));
+			}
+		}
+
+		// pushes: a new object whose prototype is `this`
+		void write_new_object_from_this() {
+			using namespace hexagon::assembly_writer;
+
+			get_current()
+				.Write(BytecodeOp(Opcode::LoadThis))
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String("new_dynamic")))
+				.Write(BytecodeOp(Opcode::LoadNull))
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String("__builtin")))
+				.Write(BytecodeOp(Opcode::GetStatic))
+				.Write(BytecodeOp(Opcode::CallField, Operand::I64(1)));
 		}
 
 		void map_arg_names() {
 			for(auto& name : arg_names) {
-				map_local(name);
+				arg_locals.push_back(map_local(name));
+			}
+		}
+
+		void note_local_store(long long local_id) {
+			if(std::find(arg_locals.begin(), arg_locals.end(), local_id) != arg_locals.end()) {
+				root().stores_arguments = true;
+			}
+		}
+
+		// Element access goes through two functions attached to the runtime
+		// (see instance_type::init_runtime_with_vm) that index arrays and
+		// hash maps natively instead of calling their __get__/__set__ members.
+		void lower_element_access() {
+			using namespace hexagon::assembly_writer;
+
+			for(auto& blk : blocks) {
+				std::size_t n_array_ops = 0;
+				for(auto& op : blk -> opcodes) {
+					if(op.opcode == Opcode::GetArrayElement || op.opcode == Opcode::SetArrayElement)
+						++n_array_ops;
+				}
+				if(n_array_ops == 0)
+					continue;
+				std::vector<BytecodeOp> new_ops;
+				new_ops.reserve(blk -> opcodes.size() + n_array_ops * 4);
+				for(auto& op : blk -> opcodes) {
+					if(op.opcode == Opcode::GetArrayElement) {
+						// (index, array) => element
+						new_ops.push_back(BytecodeOp(Opcode::LoadNull));
+						new_ops.push_back(BytecodeOp(Opcode::LoadString, Operand::String("cs_get_element")));
+						new_ops.push_back(BytecodeOp(Opcode::GetStatic));
+						new_ops.push_back(BytecodeOp(Opcode::Call, Operand::I64(2)));
+					} else if(op.opcode == Opcode::SetArrayElement) {
+						// (value, index, array) => nothing
+						new_ops.push_back(BytecodeOp(Opcode::LoadNull));
+						new_ops.push_back(BytecodeOp(Opcode::LoadString, Operand::String("cs_set_element")));
+						new_ops.push_back(BytecodeOp(Opcode::GetStatic));
+						new_ops.push_back(BytecodeOp(Opcode::Call, Operand::I64(3)));
+						new_ops.push_back(BytecodeOp(Opcode::Pop));
+					} else {
+						new_ops.push_back(op);
+					}
+				}
+				blk -> opcodes = std::move(new_ops);
 			}
 		}
 
+		enum class global_access {
+			none, read, call, read_static
+		};
+
+		// Matches a read of a global at `i`:
+		//     LoadString name; LoadThis; GetField
+		// a call through complete_call:
+		//     LoadString name; LoadThis; Dup; CallField n
+		// or a read of a function attached to the runtime:
+		//     LoadString name; GetStatic
+		// Returns the number of ops matched, or 0.
+		static std::size_t match_global_access(const std::vector<hexagon::assembly_writer::BytecodeOp>& ops, std::size_t i, global_access& kind) {
+			using namespace hexagon::assembly_writer;
+
+			kind = global_access::none;
+			if(i + 1 >= ops.size() || ops[i].opcode != Opcode::LoadString) {
+				return 0;
+			}
+			if(ops[i + 1].opcode == Opcode::GetStatic) {
+				kind = global_access::read_static;
+				return 2;
+			}
+			if(i + 2 >= ops.size() || ops[i + 1].opcode != Opcode::LoadThis) {
+				return 0;
+			}
+			if(ops[i + 2].opcode == Opcode::GetField) {
+				kind = global_access::read;
+				return 3;
+			}
+			if(i + 3 < ops.size()
+				&& ops[i + 2].opcode == Opcode::Dup
+				&& ops[i + 3].opcode == Opcode::CallField) {
+				kind = global_access::call;
+				return 4;
+			}
+			return 0;
+		}
+
+		// Walks the whole program before anything is built. Any use of
+		// `LoadString name; LoadThis` that is not a plain read or call
+		// (an assignment, a compound assignment...) makes `name` mutable.
+		void collect_globals(global_registry& registry) {
+			using namespace hexagon::assembly_writer;
+
+			for(auto& blk : blocks) {
+				auto& ops = blk -> opcodes;
+				for(std::size_t i = 0; i + 1 < ops.size(); i++) {
+					if(ops[i].opcode != Opcode::LoadString || ops[i + 1].opcode != Opcode::LoadThis) {
+						continue;
+					}
+					global_access kind;
+					if(match_global_access(ops, i, kind) == 0) {
+						registry.mutable_globals.insert(ops[i].operands[0].GetString());
+					}
+				}
+			}
+
+			for(auto& v : external_vars) {
+				registry.fixed_globals.insert(v.first);
+			}
+			for(auto& child : children) {
+				registry.fixed_globals.insert(child.first);
+				child.second -> collect_globals(registry);
+			}
+		}
+
+		// Blocks that can reach themselves, i.e. are part of a loop.
+		std::vector<bool> find_loop_blocks() const {
+			using namespace hexagon::assembly_writer;
+
+			std::vector<std::vector<std::size_t>> succ(blocks.size());
+			for(std::size_t i = 0; i < blocks.size(); i++) {
+				auto& ops = blocks[i] -> opcodes;
+				if(ops.empty()) {
+					continue;
+				}
+				auto& last = ops.back();
+				if(last.opcode == Opcode::Branch) {
+					succ[i].push_back(last.operands[0].GetI64());
+				} else if(last.opcode == Opcode::ConditionalBranch) {
+					succ[i].push_back(last.operands[0].GetI64());
+					succ[i].push_back(last.operands[1].GetI64());
+				}
+			}
+
+			std::vector<bool> in_loop(blocks.size(), false);
+			for(std::size_t start = 0; start < blocks.size(); start++) {
+				std::vector<bool> seen(blocks.size(), false);
+				std::vector<std::size_t> pending(succ[start]);
+				while(!pending.empty() && !in_loop[start]) {
+					std::size_t b = pending.back();
+					pending.pop_back();
+					if(b >= blocks.size() || seen[b]) {
+						continue;
+					}
+					if(b == start) {
+						in_loop[start] = true;
+					}
+					seen[b] = true;
+					pending.insert(pending.end(), succ[b].begin(), succ[b].end());
+				}
+			}
+			return in_loop;
+		}
+
+		struct cached_global {
+			std::string name;
+			bool is_static;
+			int local;
+		};
+
+		// Loads fixed globals and runtime statics that are used in a loop or
+		// more than once into locals at function entry, so the body does not
+		// look them up by name on every reference.
+		std::vector<cached_global> cache_globals(const global_registry& registry) {
+			using namespace hexagon::assembly_writer;
+
+			std::vector<bool> in_loop = find_loop_blocks();
+			std::unordered_map<std::string, int> uses;
+			std::vector<std::string> first_use_order; // keeps the prologue deterministic
+
+			for(std::size_t b = 1; b < blocks.size(); b++) {
+				auto& ops = blocks[b] -> opcodes;
+				for(std::size_t i = 0; i < ops.size(); i++) {
+					global_access kind;
+					std::size_t len = match_global_access(ops, i, kind);
+					if(len == 0) {
+						continue;
+					}
+					const std::string& name = ops[i].operands[0].GetString();
+					std::string key;
+					if(kind == global_access::read_static) {
+						key = "s" + name;
+					} else if(registry.is_fixed(name)) {
+						key = "g" + name;
+					}
+					if(!key.empty()) {
+						int& n_uses = uses[key];
+						if(n_uses == 0) {
+							first_use_order.push_back(key);
+						}
+						n_uses += in_loop[b] ? 2 : 1;
+					}
+					i += len - 1;
+				}
+			}
+
+			std::vector<cached_global> cached;
+			std::unordered_map<std::string, int> slots;
+			for(auto& key : first_use_order) {
+				if(uses[key] >= 2) {
+					int id = anonymous_local();
+					slots[key] = id;
+					cached.push_back(cached_global { key.substr(1), key[0] == 's', id });
+				}
+			}
+			if(cached.empty()) {
+				return cached;
+			}
+
+			for(std::size_t b = 1; b < blocks.size(); b++) {
+				auto& ops = blocks[b] -> opcodes;
+				std::vector<BytecodeOp> new_ops;
+				new_ops.reserve(ops.size());
+				for(std::size_t i = 0; i < ops.size(); i++) {
+					global_access kind;
+					std::size_t len = match_global_access(ops, i, kind);
+					auto it = len ? slots.find((kind == global_access::read_static ? "s" : "g") + ops[i].operands[0].GetString()) : slots.end();
+					if(it == slots.end()) {
+						new_ops.push_back(ops[i]);
+						continue;
+					}
+					if(kind == global_access::call) {
+						// Registry entries ignore `this`, so a plain call is equivalent.
+						new_ops.push_back(BytecodeOp(Opcode::LoadNull));
+						new_ops.push_back(BytecodeOp(Opcode::GetLocal, Operand::I64(it -> second)));
+						new_ops.push_back(BytecodeOp(Opcode::Call, ops[i + len - 1].operands[0]));
+					} else {
+						new_ops.push_back(BytecodeOp(Opcode::GetLocal, Operand::I64(it -> second)));
+					}
+					i += len - 1;
+				}
+				ops = std::move(new_ops);
+			}
+			return cached;
+		}
+
 		hexagon::ort::Function build(hexagon::ort::Runtime& rt, global_registry& registry, const hexagon::ort::Value& registry_proxy_inst, bool debug, bool optimize) {
 			using namespace hexagon;
 			using namespace hexagon::assembly_writer;
 
+			if(parent == nullptr) {
+				collect_globals(registry);
+			}
+
 			for(auto& child : children) {
 				hexagon::ort::Function cf = child.second -> build(rt, registry, registry_proxy_inst, debug, optimize);
 				registry.add(child.first, cf.Pin(rt), true);
@@ -459,57 +899,49 @@ namespace cs {
 				registry.add(v.first, v.second.to_hvm_value(), false);
 			}
 
+			lower_element_access();
+			// Globals can only be cached when `this` is the global environment.
+			std::vector<cached_global> cached_globals;
+			if(bind_this) {
+				cached_globals = cache_globals(registry);
+			}
+
 			auto& init_blk = *blocks[0];
 			init_blk.Clear();
-			init_blk.Write(BytecodeOp("InitLocal", Operand::I64(next_local_id)));
+			init_blk.Write(BytecodeOp(Opcode::InitLocal, Operand::I64(next_local_id)));
 			for(int i = 0; i < arg_names.size(); i++) {
 				init_blk
-					.Write(BytecodeOp("GetArgument", Operand::I64(i)))
-					.Write(BytecodeOp("SetLocal", Operand::I64(
+					.Write(BytecodeOp(Opcode::GetArgument, Operand::I64(i)))
+					.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(
 						map_local(arg_names[i])
 					)));
 			}
-			init_blk.Write(BytecodeOp("Branch", Operand::I64(1)));
-
-			FunctionWriter fwriter([](
-				std::vector<BasicBlockWriter>& blocks
-			) {
-				for(auto& blk : blocks) {
-					std::vector<BytecodeOp> new_ops;
-					for(auto& op : blk.opcodes) {
-						if(op.name == "GetArrayElement") {
-							// pops: array, index
-							// pushes: element
-
-							new_ops.push_back(BytecodeOp("LoadString", Operand::String("__get__")));
-							new_ops.push_back(BytecodeOp("LoadNull"));
-
-							// Rotate: (array, method_name, this) => (method_name, this, array)
-							new_ops.push_back(BytecodeOp("Rotate3"));
-
-							new_ops.push_back(BytecodeOp("CallField", Operand::I64(1)));
-						} else if(op.name == "SetArrayElement") {
-							// pops: array, index, value
-							// pushes nothing
-
-							new_ops.push_back(BytecodeOp("LoadString", Operand::String("__set__")));
-							new_ops.push_back(BytecodeOp("LoadNull"));
-
-							// Rotate: (array, method_name, this) => (method_name, this, array)
-							new_ops.push_back(BytecodeOp("Rotate3"));
-
-							new_ops.push_back(BytecodeOp("CallField", Operand::I64(2)));
-							new_ops.push_back(BytecodeOp("Pop"));
-						} else {
-							new_ops.push_back(op);
-						}
-					}
-					blk.opcodes = new_ops;
+			for(auto& g : cached_globals) {
+				init_blk.Write(BytecodeOp(Opcode::LoadString, Operand::String(g.name)));
+				if(g.is_static) {
+					init_blk.Write(BytecodeOp(Opcode::GetStatic));
+				} else {
+					init_blk
+						.Write(BytecodeOp(Opcode::LoadThis))
+						.Write(BytecodeOp(Opcode::GetField));
 				}
-			});
+				init_blk.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(g.local)));
+			}
+			init_blk.Write(BytecodeOp(Opcode::Branch, Operand::I64(1)));
+
+			FunctionWriter fwriter;
+			// Blocks are only built once, so hand them over instead of copying.
 			for(auto& blk : blocks) {
-				fwriter.Write(*blk);
+				fwriter.Write(std::move(*blk));
 			}
+			fwriter.Transform(ControlFlowSimplifier::Run);
+			fwriter.Transform([](std::vector<BasicBlockWriter>& bbs) {
+				for(auto& bb : bbs) {
+					PeepholeOptimizer::Run(bb);
+				}
+			});
+			fwriter.Transform(LocalTypeInference::Run);
+			fwriter.Transform(LocalAllocator::Run);
 
 			if(debug) {
 				std::cerr << fwriter.ToJson() << std::endl;
@@ -520,7 +952,9 @@ namespace cs {
 				target_fn.EnableOptimization();
 			}
 
-			target_fn.BindThis(registry_proxy_inst);
+			if(bind_this) {
+				target_fn.BindThis(registry_proxy_inst);
+			}
 
 			return target_fn;
 		}
@@ -562,6 +996,14 @@ namespace cs {
 		int anonymous_local() {
 			return next_local_id++;
 		}
+
+		// Maps a name to a new local in the innermost scope, hiding any
+		// local of the same name in the enclosing scopes.
+		int map_new_local(const std::string& name) {
+			int id = anonymous_local();
+			vars.back().locals[name] = id;
+			return id;
+		}
 	};
 
 	builder_var_scope::builder_var_scope(function_builder *b) {
@@ -650,5 +1092,7 @@ namespace cs {
 		var parse_expr(const cov::tree<token_base *>::iterator &);
 
 		void generate_code_from_expr(const cov::tree<token_base *>::iterator &it, function_builder& builder);
+
+		bool generate_inline_call(const cov::tree<token_base *>::iterator &it, function_builder& builder);
 	};
 }
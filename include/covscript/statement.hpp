@@ -58,6 +58,8 @@ namespace cs {
 		}
 
 		virtual void run() override;
+
+		virtual void generate_code(function_builder& builder) override;
 	};
 
 	class statement_var final : public statement_base {
@@ -126,6 +128,8 @@ namespace cs {
 		}
 
 		virtual void run() override;
+
+		virtual void generate_code(function_builder& builder) override;
 	};
 
 	class statement_namespace final : public statement_base {
@@ -143,6 +147,8 @@ namespace cs {
 		}
 
 		virtual void run() override;
+
+		virtual void generate_code(function_builder& builder) override;
 	};
 
 	class statement_if final : public statement_base {
@@ -221,6 +227,8 @@ namespace cs {
 		}
 
 		virtual void run() override;
+
+		virtual void generate_code(function_builder& builder) override;
 	};
 
 	class statement_case final : public statement_base {
@@ -318,6 +326,11 @@ namespace cs {
 		{
 			throw syntax_error("Do not allowed standalone until statement.");
 		}
+
+		virtual void generate_code(function_builder&) override
+		{
+			throw syntax_error("Do not allowed standalone until statement.");
+		}
 	};
 
 	class statement_loop final : public statement_base {
@@ -401,6 +414,8 @@ namespace cs {
 		}
 
 		virtual void run() override;
+
+		virtual void generate_code(function_builder& builder) override;
 	};
 
 	class statement_function final : public statement_base {
@@ -428,9 +443,18 @@ namespace cs {
 			mIsMemFn = true;
 		}
 
+		const std::string &get_name() const
+		{
+			return mName;
+		}
+
 		virtual void run() override;
 
 		virtual void generate_code(function_builder& builder) override;
+
+		// Compiles the function as a method of a struct or namespace and
+		// pushes it onto the stack.
+		void generate_method(function_builder& builder);
 	};
 
 	class statement_return final : public statement_base {
@@ -446,6 +470,11 @@ namespace cs {
 			return statement_types::return_;
 		}
 
+		const cov::tree<token_base *> &get_tree() const
+		{
+			return mTree;
+		}
+
 		virtual void run() override;
 
 		virtual void generate_code(function_builder& builder) override;
@@ -485,6 +514,8 @@ namespace cs {
 		}
 
 		virtual void run() override;
+
+		virtual void generate_code(function_builder& builder) override;
 	};
 
 	class statement_catch final : public statement_base {
@@ -524,5 +555,7 @@ namespace cs {
 		}
 
 		virtual void run() override;
+
+		virtual void generate_code(function_builder& builder) override;
 	};
 }
@@ -0,0 +1,391 @@
+#pragma once
+/*
+* Covariant Script String Map
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Affero General Public License as published
+* by the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Affero General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* Copyright (C) 2018 Michael Lee(李登淳)
+* Email: mikecovlee@163.com
+* Github: https://github.com/mikecovlee
+*/
+#include <functional>
+#include <stdexcept>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace cs_impl {
+	/*
+	* Hash map from std::string keys, behind the string_map type.
+	* Entries live in a single open addressed table split into groups of 16
+	* slots. Every slot has a control byte that is either empty, deleted, or
+	* the low 7 bits of the hash of its key, so a probe tests a whole group
+	* with one comparison (SSE2 where available) and only compares the keys
+	* whose byte matched. The full hash is kept with each entry: key
+	* comparisons are skipped for differing hashes, and growing the table
+	* never hashes a key again.
+	*/
+	template<typename T>
+	class basic_string_map final {
+	public:
+		using key_type=std::string;
+		using mapped_type=T;
+		using value_type=std::pair<std::string, T>;
+		using size_type=std::size_t;
+	private:
+		enum : int {
+			group_width = 16, ctrl_empty = -128, ctrl_deleted = -2
+		};
+
+		static constexpr size_type npos = static_cast<size_type>(-1);
+
+		struct slot_type {
+			std::size_t hash = 0;
+			value_type value;
+		};
+
+		std::vector<std::int8_t> m_ctrl;
+		std::vector<slot_type> m_slots;
+		size_type m_size = 0;
+		// Slots that are not empty, deleted ones included.
+		size_type m_used = 0;
+
+		// Bit i is set if control byte i of the group equals ctrl.
+		static std::uint32_t match(const std::int8_t *group, std::int8_t ctrl)
+		{
+#ifdef __SSE2__
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+			return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(ctrl))));
+#else
+			std::uint32_t mask = 0;
+			for (int i = 0; i < group_width; ++i)
+				if (group[i] == ctrl)
+					mask |= std::uint32_t(1) << i;
+			return mask;
+#endif
+		}
+
+		// Bit i is set if slot i of the group is empty or deleted.
+		static std::uint32_t match_free(const std::int8_t *group)
+		{
+#ifdef __SSE2__
+			return static_cast<std::uint32_t>(_mm_movemask_epi8(
+			                                      _mm_loadu_si128(reinterpret_cast<const __m128i *>(group))));
+#else
+			std::uint32_t mask = 0;
+			for (int i = 0; i < group_width; ++i)
+				if (group[i] < 0)
+					mask |= std::uint32_t(1) << i;
+			return mask;
+#endif
+		}
+
+		static size_type lowest_bit(std::uint32_t mask)
+		{
+#ifdef __GNUC__
+			return __builtin_ctz(mask);
+#else
+			size_type bit = 0;
+			while ((mask & 1) == 0) {
+				mask >>= 1;
+				++bit;
+			}
+			return bit;
+#endif
+		}
+
+		static std::int8_t hash_ctrl(std::size_t hash)
+		{
+			return static_cast<std::int8_t>(hash & 0x7f);
+		}
+
+		/*
+		* Walks the groups a key with this hash may be in. Groups are visited
+		* in triangular steps, which reaches every group of a power of two
+		* table. Stops at the slot holding key and returns it; otherwise
+		* returns npos and stores the first free slot seen in free_slot.
+		*/
+		size_type probe(const std::string &key, std::size_t hash, size_type &free_slot) const
+		{
+			free_slot = npos;
+			if (m_ctrl.empty())
+				return npos;
+			const size_type group_mask = m_ctrl.size() / group_width - 1;
+			const std::int8_t ctrl = hash_ctrl(hash);
+			size_type group = (hash >> 7) & group_mask;
+			for (size_type step = 1;; group = (group + step++) & group_mask) {
+				const std::int8_t *bytes = m_ctrl.data() + group * group_width;
+				for (std::uint32_t mask = match(bytes, ctrl); mask != 0; mask &= mask - 1) {
+					size_type idx = group * group_width + lowest_bit(mask);
+					if (m_slots[idx].hash == hash && m_slots[idx].value.first == key)
+						return idx;
+				}
+				if (free_slot == npos) {
+					std::uint32_t mask = match_free(bytes);
+					if (mask != 0)
+						free_slot = group * group_width + lowest_bit(mask);
+				}
+				if (match(bytes, ctrl_empty) != 0)
+					return npos;
+			}
+		}
+
+		// First free slot for a hash that is known not to be in the table.
+		size_type free_slot_for(std::size_t hash) const
+		{
+			const size_type group_mask = m_ctrl.size() / group_width - 1;
+			size_type group = (hash >> 7) & group_mask;
+			for (size_type step = 1;; group = (group + step++) & group_mask) {
+				std::uint32_t mask = match_free(m_ctrl.data() + group * group_width);
+				if (mask != 0)
+					return group * group_width + lowest_bit(mask);
+			}
+		}
+
+		void rehash(size_type capacity)
+		{
+			std::vector<std::int8_t> ctrl(capacity, std::int8_t(ctrl_empty));
+			std::vector<slot_type> slots(capacity);
+			ctrl.swap(m_ctrl);
+			slots.swap(m_slots);
+			m_used = m_size;
+			for (size_type i = 0; i < ctrl.size(); ++i) {
+				if (ctrl[i] < 0)
+					continue;
+				size_type idx = free_slot_for(slots[i].hash);
+				m_ctrl[idx] = ctrl[i];
+				m_slots[idx] = std::move(slots[i]);
+			}
+		}
+
+		// Keeps at least one slot in eight empty, so every probe ends.
+		// Tables that are mostly deleted slots are cleaned up in place.
+		bool reserve_one()
+		{
+			if ((m_used + 1) * 8 <= m_ctrl.size() * 7)
+				return false;
+			if (m_ctrl.empty())
+				rehash(group_width);
+			else if (m_size * 16 >= m_ctrl.size() * 7)
+				rehash(m_ctrl.size() * 2);
+			else
+				rehash(m_ctrl.size());
+			return true;
+		}
+
+		size_type insert_new(std::string key, std::size_t hash, size_type free_slot)
+		{
+			if (reserve_one() || free_slot == npos)
+				free_slot = free_slot_for(hash);
+			if (m_ctrl[free_slot] == ctrl_empty)
+				++m_used;
+			m_ctrl[free_slot] = hash_ctrl(hash);
+			m_slots[free_slot].hash = hash;
+			m_slots[free_slot].value.first = std::move(key);
+			++m_size;
+			return free_slot;
+		}
+
+		template<typename MapT, typename ValueT>
+		class iterator_base final {
+			friend class basic_string_map;
+
+			MapT *m_map;
+			size_type m_idx;
+
+			void skip_free()
+			{
+				while (m_idx < m_map->m_ctrl.size() && m_map->m_ctrl[m_idx] < 0)
+					++m_idx;
+			}
+
+		public:
+			using iterator_category=std::forward_iterator_tag;
+			using value_type=typename basic_string_map::value_type;
+			using difference_type=std::ptrdiff_t;
+			using pointer=ValueT *;
+			using reference=ValueT &;
+
+			iterator_base(MapT *map, size_type idx) : m_map(map), m_idx(idx)
+			{
+				skip_free();
+			}
+
+			reference operator*() const
+			{
+				return m_map->m_slots[m_idx].value;
+			}
+
+			pointer operator->() const
+			{
+				return &m_map->m_slots[m_idx].value;
+			}
+
+			iterator_base &operator++()
+			{
+				++m_idx;
+				skip_free();
+				return *this;
+			}
+
+			iterator_base operator++(int)
+			{
+				iterator_base it(*this);
+				++*this;
+				return it;
+			}
+
+			bool operator==(const iterator_base &it) const
+			{
+				return m_idx == it.m_idx;
+			}
+
+			bool operator!=(const iterator_base &it) const
+			{
+				return m_idx != it.m_idx;
+			}
+		};
+
+	public:
+		// Keys must not be changed through an iterator.
+		using iterator=iterator_base<basic_string_map, value_type>;
+		using const_iterator=iterator_base<const basic_string_map, const value_type>;
+
+		static std::size_t hash(const std::string &key)
+		{
+			static std::hash<std::string> gen;
+			return gen(key);
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+		size_type size() const
+		{
+			return m_size;
+		}
+
+		void clear()
+		{
+			m_ctrl.clear();
+			m_slots.clear();
+			m_size = m_used = 0;
+		}
+
+		iterator begin()
+		{
+			return iterator(this, 0);
+		}
+
+		iterator end()
+		{
+			return iterator(this, m_ctrl.size());
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, 0);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(this, m_ctrl.size());
+		}
+
+		// Callers that look the same key up repeatedly may hash it once.
+		iterator find(const std::string &key, std::size_t hash)
+		{
+			size_type free_slot;
+			size_type idx = probe(key, hash, free_slot);
+			return iterator(this, idx == npos ? m_ctrl.size() : idx);
+		}
+
+		const_iterator find(const std::string &key, std::size_t hash) const
+		{
+			size_type free_slot;
+			size_type idx = probe(key, hash, free_slot);
+			return const_iterator(this, idx == npos ? m_ctrl.size() : idx);
+		}
+
+		iterator find(const std::string &key)
+		{
+			return find(key, hash(key));
+		}
+
+		const_iterator find(const std::string &key) const
+		{
+			return find(key, hash(key));
+		}
+
+		size_type count(const std::string &key) const
+		{
+			return find(key) == end() ? 0 : 1;
+		}
+
+		T &at(const std::string &key)
+		{
+			iterator it = find(key);
+			if (it == end())
+				throw std::out_of_range("at: key not present");
+			return it->second;
+		}
+
+		const T &at(const std::string &key) const
+		{
+			const_iterator it = find(key);
+			if (it == end())
+				throw std::out_of_range("at: key not present");
+			return it->second;
+		}
+
+		// Looks the key up and inserts it with value if it is missing, in
+		// one probe. The bool is true if the key was inserted.
+		std::pair<iterator, bool> emplace(const std::string &key, const T &value)
+		{
+			std::size_t key_hash = hash(key);
+			size_type free_slot;
+			size_type idx = probe(key, key_hash, free_slot);
+			if (idx != npos)
+				return std::make_pair(iterator(this, idx), false);
+			idx = insert_new(key, key_hash, free_slot);
+			m_slots[idx].value.second = value;
+			return std::make_pair(iterator(this, idx), true);
+		}
+
+		T &operator[](const std::string &key)
+		{
+			return emplace(key, T()).first->second;
+		}
+
+		size_type erase(const std::string &key)
+		{
+			iterator it = find(key);
+			if (it == end())
+				return 0;
+			m_ctrl[it.m_idx] = ctrl_deleted;
+			m_slots[it.m_idx] = slot_type();
+			--m_size;
+			return 1;
+		}
+	};
+}
@@ -333,6 +333,12 @@ namespace cs {
 	class token_arglist final : public token_base {
 		std::deque<cov::tree<token_base *>> mTreeList;
 	public:
+		// Call site cache of runtime_type::parse_fcall: the inline body of
+		// the function last called with these arguments, and that body with
+		// the arguments in place (empty if they cannot be inlined).
+		const cov::tree<token_base *> *inline_source = nullptr;
+		cov::tree<token_base *> inline_expr;
+
 		token_arglist() = default;
 
 		token_arglist(const std::deque<cov::tree<token_base *>> &tlist) : mTreeList(tlist) {}
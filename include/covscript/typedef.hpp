@@ -48,6 +48,7 @@ namespace cs {
 	using array=std::deque<var>;
 	using pair=std::pair<var, var>;
 	using hash_map=spp::sparse_hash_map<var, var>;
+	using string_map=cs_impl::basic_string_map<var>;
 	using vector=std::vector<var>;
 	using context_t=std::shared_ptr<context_type>;
 	using extension=name_space;
@@ -152,6 +152,7 @@ public:
 
     bool IsString(Runtime& rt) const;
     std::string ToString(Runtime& rt) const;
+    void ReadString(Runtime& rt, std::string& out) const;
     ObjectHandle ToObjectHandle(Runtime& rt) const;
 
     bool IsNull() const noexcept {
@@ -367,6 +368,25 @@ public:
 
 class ObjectProxy;
 
+// Arguments of a call to a proxied object, read in place from the buffer
+// the executor passes in.
+class ArgumentList {
+private:
+    const HxOrtValue *args;
+    unsigned int n_args;
+
+public:
+    ArgumentList(const HxOrtValue *_args, unsigned int _n_args) : args(_args), n_args(_n_args) {}
+
+    unsigned int size() const noexcept {
+        return n_args;
+    }
+
+    Value operator[](unsigned int i) const noexcept {
+        return Value(args[i]);
+    }
+};
+
 class ProxiedObject {
 private:
     HxOrtObjectProxy proxy = nullptr;
@@ -412,7 +432,7 @@ public:
 
     }
 
-    virtual Value Call(const std::vector<Value>& args) {
+    virtual Value Call(const ArgumentList& args) {
         throw std::runtime_error("Call: Not implemented");
     };
 
@@ -448,12 +468,8 @@ public:
         ) -> int {
             ProxiedObject *proxied = (ProxiedObject *) data;
 
-            std::vector<Value> target_args;
-            for(unsigned int i = 0; i < n_args; i++) {
-                target_args.push_back(args[i]);
-            }
             try {
-                Value ret = proxied -> Call(target_args);
+                Value ret = proxied -> Call(ArgumentList(args, n_args));
                 *place = ret.Extract();
                 return 0;
             } catch(const std::exception& e) {
@@ -557,6 +573,12 @@ Value Value::FromString(const std::string& s, Runtime& rt) {
 }
 
 std::string Value::ToString(Runtime& rt) const {
+    std::string ret;
+    ReadString(rt, ret);
+    return ret;
+}
+
+void Value::ReadString(Runtime& rt, std::string& out) const {
     char *v = hexagon_ort_value_read_string(
         &res,
         rt._impl_handle()
@@ -564,9 +586,8 @@ std::string Value::ToString(Runtime& rt) const {
     if(!v) {
         throw std::runtime_error("Cannot convert to string");
     }
-    std::string ret = v;
+    out.assign(v);
     hexagon_glue_destroy_cstring(v);
-    return ret;
 }
 
 bool Value::IsString(Runtime& rt) const {
@@ -3,15 +3,180 @@
 #include <string>
 #include <stdexcept>
 #include <vector>
-#include <sstream>
-#include <iomanip>
+#include <unordered_set>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <utility>
+#include <algorithm>
+#include <functional>
 #include "ort.h"
 
 namespace hexagon {
 namespace assembly_writer {
+	enum class Opcode : unsigned char {
+		LoadNull,
+		LoadInt,
+		LoadFloat,
+		LoadString,
+		LoadBool,
+		LoadThis,
+		Call,
+		CallField,
+		Pop,
+		Dup,
+		InitLocal,
+		GetLocal,
+		SetLocal,
+		GetArgument,
+		GetStatic,
+		GetField,
+		SetField,
+		GetArrayElement,
+		SetArrayElement,
+		Branch,
+		ConditionalBranch,
+		Return,
+		Add,
+		Sub,
+		Mul,
+		Div,
+		Mod,
+		Pow,
+		IntAdd,
+		IntSub,
+		IntMul,
+		FloatAdd,
+		FloatSub,
+		FloatMul,
+		FloatDiv,
+		CastToInt,
+		CastToBool,
+		CastToString,
+		And,
+		Or,
+		Not,
+		TestLt,
+		TestLe,
+		TestEq,
+		TestNe,
+		TestGe,
+		TestGt,
+		Rotate2,
+		Rotate3,
+		RotateReverse,
+	};
+
+	// The names are only needed to serialize the code.
+	inline const char * OpcodeName(Opcode op) {
+		switch(op) {
+			case Opcode::LoadNull: return "LoadNull";
+			case Opcode::LoadInt: return "LoadInt";
+			case Opcode::LoadFloat: return "LoadFloat";
+			case Opcode::LoadString: return "LoadString";
+			case Opcode::LoadBool: return "LoadBool";
+			case Opcode::LoadThis: return "LoadThis";
+			case Opcode::Call: return "Call";
+			case Opcode::CallField: return "CallField";
+			case Opcode::Pop: return "Pop";
+			case Opcode::Dup: return "Dup";
+			case Opcode::InitLocal: return "InitLocal";
+			case Opcode::GetLocal: return "GetLocal";
+			case Opcode::SetLocal: return "SetLocal";
+			case Opcode::GetArgument: return "GetArgument";
+			case Opcode::GetStatic: return "GetStatic";
+			case Opcode::GetField: return "GetField";
+			case Opcode::SetField: return "SetField";
+			case Opcode::GetArrayElement: return "GetArrayElement";
+			case Opcode::SetArrayElement: return "SetArrayElement";
+			case Opcode::Branch: return "Branch";
+			case Opcode::ConditionalBranch: return "ConditionalBranch";
+			case Opcode::Return: return "Return";
+			case Opcode::Add: return "Add";
+			case Opcode::Sub: return "Sub";
+			case Opcode::Mul: return "Mul";
+			case Opcode::Div: return "Div";
+			case Opcode::Mod: return "Mod";
+			case Opcode::Pow: return "Pow";
+			case Opcode::IntAdd: return "IntAdd";
+			case Opcode::IntSub: return "IntSub";
+			case Opcode::IntMul: return "IntMul";
+			case Opcode::FloatAdd: return "FloatAdd";
+			case Opcode::FloatSub: return "FloatSub";
+			case Opcode::FloatMul: return "FloatMul";
+			case Opcode::FloatDiv: return "FloatDiv";
+			case Opcode::CastToInt: return "CastToInt";
+			case Opcode::CastToBool: return "CastToBool";
+			case Opcode::CastToString: return "CastToString";
+			case Opcode::And: return "And";
+			case Opcode::Or: return "Or";
+			case Opcode::Not: return "Not";
+			case Opcode::TestLt: return "TestLt";
+			case Opcode::TestLe: return "TestLe";
+			case Opcode::TestEq: return "TestEq";
+			case Opcode::TestNe: return "TestNe";
+			case Opcode::TestGe: return "TestGe";
+			case Opcode::TestGt: return "TestGt";
+			case Opcode::Rotate2: return "Rotate2";
+			case Opcode::Rotate3: return "Rotate3";
+			case Opcode::RotateReverse: return "RotateReverse";
+		}
+		throw std::runtime_error("Unknown opcode");
+	}
+
+	// Strings of the operands written by one compile. Operands point into
+	// the pool, so copying one never allocates. Each thread has its own
+	// current pool, installed by a StringPoolScope, so no lock is needed.
+	class StringPool {
+		std::unordered_set<std::string> strings;
+
+		static StringPool *&Active() {
+			static thread_local StringPool *pool = nullptr;
+			return pool;
+		}
+
+		friend class StringPoolScope;
+	public:
+		static StringPool& Current() {
+			if(Active() == nullptr) {
+				throw std::logic_error("String operand written outside a StringPoolScope");
+			}
+			return *Active();
+		}
+
+		const std::string * Intern(const std::string& s) {
+			return &*strings.insert(s).first;
+		}
+	};
+
+	// Makes a new pool current for the calling thread, and frees it when the
+	// scope ends: open one around generating and building a function, and
+	// drop the writers before it ends. A nested scope keeps using the pool
+	// of the outer one, whose operands may still be in use.
+	class StringPoolScope {
+		std::unique_ptr<StringPool> pool;
+	public:
+		StringPoolScope() {
+			if(StringPool::Active() == nullptr) {
+				pool.reset(new StringPool());
+				StringPool::Active() = pool.get();
+			}
+		}
+
+		StringPoolScope(const StringPoolScope&) = delete;
+		StringPoolScope& operator=(const StringPoolScope&) = delete;
+
+		~StringPoolScope() {
+			if(pool != nullptr) {
+				StringPool::Active() = nullptr;
+			}
+		}
+	};
+
 	// we skip the `usize` case here because the serializer
 	// doesn't care.
-	enum class OperandType {
+	enum class OperandType : unsigned char {
 		i64_,
 		f64_,
 		string_,
@@ -20,10 +185,14 @@ namespace assembly_writer {
 	struct Operand {
 		OperandType type;
 
-		long long i64_value;
-		double f64_value;
-		std::string string_value;
-		bool bool_value;
+		union {
+			long long i64_value;
+			double f64_value;
+			const std::string *string_value;
+			bool bool_value;
+		};
+
+		Operand() : type(OperandType::i64_), i64_value(0) {}
 
 		static Operand I64(long long i) {
 			Operand v;
@@ -42,7 +211,7 @@ namespace assembly_writer {
 		static Operand String(const std::string& i) {
 			Operand v;
 			v.type = OperandType::string_;
-			v.string_value = i;
+			v.string_value = StringPool::Current().Intern(i);
 			return v;
 		}
 
@@ -53,28 +222,28 @@ namespace assembly_writer {
 			return v;
 		}
 
-		long long GetI64() {
+		long long GetI64() const {
 			if(type != OperandType::i64_) {
 				throw std::runtime_error("Type mismatch");
 			}
 			return i64_value;
 		}
 
-		double GetF64() {
+		double GetF64() const {
 			if(type != OperandType::f64_) {
 				throw std::runtime_error("Type mismatch");
 			}
 			return f64_value;
 		}
 
-		std::string& GetString() {
+		const std::string& GetString() const {
 			if(type != OperandType::string_) {
 				throw std::runtime_error("Type mismatch");
 			}
-			return string_value;
+			return *string_value;
 		}
 
-		bool GetBool() {
+		bool GetBool() const {
 			if(type != OperandType::bool_) {
 				throw std::runtime_error("Type mismatch");
 			}
@@ -83,29 +252,37 @@ namespace assembly_writer {
 	};
 
 	struct BytecodeOp {
-		std::string name;
-		std::vector<Operand> operands;
+		Opcode opcode;
+		unsigned char n_operands;
+		Operand operands[2];
 
-		BytecodeOp(const std::string& _name) {
-			name = _name;
+		BytecodeOp(Opcode _opcode) {
+			opcode = _opcode;
+			n_operands = 0;
 		}
 
 		BytecodeOp(
-			const std::string& _name,
+			Opcode _opcode,
 			const Operand& arg1
 		) {
-			name = _name;
-			operands.push_back(arg1);
+			opcode = _opcode;
+			n_operands = 1;
+			operands[0] = arg1;
 		}
 
 		BytecodeOp(
-			const std::string& _name,
+			Opcode _opcode,
 			const Operand& arg1,
 			const Operand& arg2
 		) {
-			name = _name;
-			operands.push_back(arg1);
-			operands.push_back(arg2);
+			opcode = _opcode;
+			n_operands = 2;
+			operands[0] = arg1;
+			operands[1] = arg2;
+		}
+
+		const char * Name() const {
+			return OpcodeName(opcode);
 		}
 	};
 
@@ -133,46 +310,796 @@ namespace assembly_writer {
 		}
 	};
 
+	// Local rewrites on a single basic block. Every rule keeps the stack
+	// effect and the observable side effects of the sequence it replaces.
+	class PeepholeOptimizer {
+	private:
+		// Pushes one value without touching the rest of the stack or
+		// having any side effect.
+		static bool IsPurePush(const BytecodeOp& op) {
+			switch(op.opcode) {
+				case Opcode::LoadNull:
+				case Opcode::LoadInt:
+				case Opcode::LoadFloat:
+				case Opcode::LoadString:
+				case Opcode::LoadBool:
+				case Opcode::LoadThis:
+				case Opcode::GetLocal:
+				case Opcode::GetArgument:
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		static bool IsLocalOp(const BytecodeOp& op, Opcode opcode, long long id) {
+			return op.opcode == opcode && op.operands[0].GetI64() == id;
+		}
+
+		static void DropTail(std::vector<BytecodeOp>& out, std::size_t count) {
+			out.erase(out.end() - count, out.end());
+		}
+
+		// Tries to shorten the tail of `out`. Returns true if it changed.
+		static bool ReduceTail(std::vector<BytecodeOp>& out) {
+			std::size_t n = out.size();
+			if(n == 0) {
+				return false;
+			}
+
+			BytecodeOp& last = out[n - 1];
+
+			// Reversing zero or one element is a no-op.
+			if(last.opcode == Opcode::RotateReverse && last.operands[0].GetI64() <= 1) {
+				out.pop_back();
+				return true;
+			}
+
+			if(n < 2) {
+				return false;
+			}
+
+			BytecodeOp& prev = out[n - 2];
+
+			switch(last.opcode) {
+				case Opcode::Rotate2:
+					// Rotate2; Rotate2 => (nothing)
+					if(prev.opcode == Opcode::Rotate2) {
+						DropTail(out, 2);
+						return true;
+					}
+					// a; b; Rotate2 => b; a
+					if(n >= 3 && IsPurePush(prev) && IsPurePush(out[n - 3])) {
+						std::swap(out[n - 3], out[n - 2]);
+						out.pop_back();
+						return true;
+					}
+					break;
+				case Opcode::Rotate3:
+					// Rotate3; Rotate3; Rotate3 => (nothing)
+					if(n >= 3 && prev.opcode == Opcode::Rotate3 && out[n - 3].opcode == Opcode::Rotate3) {
+						DropTail(out, 3);
+						return true;
+					}
+					break;
+				case Opcode::Pop:
+					// Dup; Pop / GetLocal x; Pop / LoadXxx; Pop => (nothing)
+					if(prev.opcode == Opcode::Dup || IsPurePush(prev)) {
+						DropTail(out, 2);
+						return true;
+					}
+					// Dup; SetLocal x; Pop => SetLocal x
+					if(n >= 3 && prev.opcode == Opcode::SetLocal && out[n - 3].opcode == Opcode::Dup) {
+						out[n - 3] = prev;
+						DropTail(out, 2);
+						return true;
+					}
+					break;
+				case Opcode::GetLocal:
+					// SetLocal x; GetLocal x => Dup; SetLocal x
+					if(IsLocalOp(prev, Opcode::SetLocal, last.operands[0].GetI64())) {
+						last = prev;
+						prev = BytecodeOp(Opcode::Dup);
+						return true;
+					}
+					break;
+				case Opcode::Sub:
+					// Unary minus on a constant: c; LoadInt 0; Sub => -c
+					if(n >= 3 && prev.opcode == Opcode::LoadInt && prev.operands[0].GetI64() == 0) {
+						BytecodeOp& value = out[n - 3];
+						if(value.opcode == Opcode::LoadInt && value.operands[0].GetI64() != LLONG_MIN) {
+							value = BytecodeOp(Opcode::LoadInt, Operand::I64(-value.operands[0].GetI64()));
+						} else if(value.opcode == Opcode::LoadFloat) {
+							value = BytecodeOp(Opcode::LoadFloat, Operand::F64(0.0 - value.operands[0].GetF64()));
+						} else {
+							break;
+						}
+						DropTail(out, 2);
+						return true;
+					}
+					break;
+				default:
+					break;
+			}
+
+			return false;
+		}
+
+	public:
+		static void Run(BasicBlockWriter& bb) {
+			std::vector<BytecodeOp> out;
+			out.reserve(bb.opcodes.size());
+
+			// A rewrite can expose another one earlier in the block
+			// (e.g. after two pushes are swapped), so repeat until stable.
+			bool changed = true;
+			while(changed) {
+				changed = false;
+				out.clear();
+				for(auto& op : bb.opcodes) {
+					out.push_back(op);
+					while(ReduceTail(out)) {
+						changed = true;
+					}
+				}
+				bb.opcodes.swap(out);
+			}
+		}
+	};
+
+	// Infers the types of locals across a whole function and replaces
+	// generic arithmetic with typed opcodes where both operands are known
+	// to be ints or floats. Locals are typed flow-insensitively: a slot
+	// has a type only if every value stored into it has that type.
+	class LocalTypeInference {
+	private:
+		enum class ValueType : unsigned char {
+			Unknown, // nothing stored yet
+			Int,
+			Float,
+			Bool,
+			String,
+			Any
+		};
+
+		struct StackValue {
+			ValueType type;
+			long long producer; // index of the LoadInt that pushed it, or -1
+		};
+
+		static ValueType Join(ValueType a, ValueType b) {
+			if(a == ValueType::Unknown) return b;
+			if(b == ValueType::Unknown) return a;
+			return a == b ? a : ValueType::Any;
+		}
+
+		static StackValue Pop(std::vector<StackValue>& stack) {
+			if(stack.empty()) {
+				return StackValue { ValueType::Any, -1 };
+			}
+			StackValue v = stack.back();
+			stack.pop_back();
+			return v;
+		}
+
+		static void Push(std::vector<StackValue>& stack, ValueType type) {
+			stack.push_back(StackValue { type, -1 });
+		}
+
+		static Opcode Specialize(Opcode op, ValueType type) {
+			if(type == ValueType::Int) {
+				switch(op) {
+					case Opcode::Add: return Opcode::IntAdd;
+					case Opcode::Sub: return Opcode::IntSub;
+					case Opcode::Mul: return Opcode::IntMul;
+					default: return op;
+				}
+			}
+			if(type == ValueType::Float) {
+				switch(op) {
+					case Opcode::Add: return Opcode::FloatAdd;
+					case Opcode::Sub: return Opcode::FloatSub;
+					case Opcode::Mul: return Opcode::FloatMul;
+					case Opcode::Div: return Opcode::FloatDiv;
+					default: return op;
+				}
+			}
+			return op;
+		}
+
+		// Simulates one block on an abstract stack. With `rewrite` set,
+		// also specializes the block using the final local types.
+		static void RunBlock(
+			std::vector<BytecodeOp>& ops,
+			std::vector<ValueType>& locals,
+			bool rewrite
+		) {
+			std::vector<StackValue> stack;
+			std::vector<bool> removed;
+			if(rewrite) {
+				removed.resize(ops.size(), false);
+			}
+
+			for(std::size_t i = 0; i < ops.size(); i++) {
+				BytecodeOp& op = ops[i];
+
+				switch(op.opcode) {
+					case Opcode::LoadInt:
+						stack.push_back(StackValue { ValueType::Int, (long long) i });
+						break;
+					case Opcode::LoadFloat:
+						Push(stack, ValueType::Float);
+						break;
+					case Opcode::LoadString:
+						Push(stack, ValueType::String);
+						break;
+					case Opcode::LoadBool:
+						Push(stack, ValueType::Bool);
+						break;
+					case Opcode::LoadNull:
+					case Opcode::LoadThis:
+					case Opcode::GetArgument:
+						Push(stack, ValueType::Any);
+						break;
+					case Opcode::GetLocal: {
+						std::size_t id = op.operands[0].GetI64();
+						ValueType t = id < locals.size() ? locals[id] : ValueType::Any;
+						Push(stack, t == ValueType::Unknown ? ValueType::Any : t);
+						break;
+					}
+					case Opcode::SetLocal: {
+						std::size_t id = op.operands[0].GetI64();
+						if(id >= locals.size()) {
+							locals.resize(id + 1, ValueType::Unknown);
+						}
+						locals[id] = Join(locals[id], Pop(stack).type);
+						break;
+					}
+					case Opcode::Dup: {
+						StackValue v = Pop(stack);
+						v.producer = -1;
+						stack.push_back(v);
+						stack.push_back(v);
+						break;
+					}
+					case Opcode::Pop:
+						Pop(stack);
+						break;
+					case Opcode::Rotate2: {
+						StackValue a = Pop(stack);
+						StackValue b = Pop(stack);
+						stack.push_back(a);
+						stack.push_back(b);
+						break;
+					}
+					case Opcode::Rotate3: {
+						StackValue c = Pop(stack);
+						StackValue b = Pop(stack);
+						StackValue a = Pop(stack);
+						stack.push_back(b);
+						stack.push_back(c);
+						stack.push_back(a);
+						break;
+					}
+					case Opcode::RotateReverse: {
+						// Only used to order call arguments; forget their types.
+						long long n = op.operands[0].GetI64();
+						for(long long k = 0; k < n; k++) Pop(stack);
+						for(long long k = 0; k < n; k++) Push(stack, ValueType::Any);
+						break;
+					}
+					case Opcode::Add:
+					case Opcode::Sub:
+					case Opcode::Mul:
+					case Opcode::Div: {
+						StackValue left = Pop(stack);
+						StackValue right = Pop(stack);
+						ValueType t = ValueType::Any;
+
+						if(left.type == right.type) {
+							t = left.type;
+						} else if(left.type == ValueType::Int && right.type == ValueType::Float && left.producer >= 0) {
+							// `0 - x` from unary minus: promote the constant.
+							t = ValueType::Float;
+							if(rewrite) {
+								BytecodeOp& load = ops[left.producer];
+								load = BytecodeOp(Opcode::LoadFloat, Operand::F64((double) load.operands[0].GetI64()));
+							}
+						} else if(right.type == ValueType::Int && left.type == ValueType::Float && right.producer >= 0) {
+							t = ValueType::Float;
+							if(rewrite) {
+								BytecodeOp& load = ops[right.producer];
+								load = BytecodeOp(Opcode::LoadFloat, Operand::F64((double) load.operands[0].GetI64()));
+							}
+						}
+
+						Opcode specialized = Specialize(op.opcode, t);
+						if(specialized == op.opcode) {
+							t = ValueType::Any;
+						} else if(rewrite) {
+							op = BytecodeOp(specialized);
+						}
+						Push(stack, t);
+						break;
+					}
+					case Opcode::IntAdd:
+					case Opcode::IntSub:
+					case Opcode::IntMul: {
+						StackValue left = Pop(stack);
+						StackValue right = Pop(stack);
+						Push(stack, left.type == ValueType::Int && right.type == ValueType::Int ? ValueType::Int : ValueType::Any);
+						break;
+					}
+					case Opcode::FloatAdd:
+					case Opcode::FloatSub:
+					case Opcode::FloatMul:
+					case Opcode::FloatDiv:
+						Pop(stack);
+						Pop(stack);
+						Push(stack, ValueType::Float);
+						break;
+					case Opcode::Mod:
+					case Opcode::Pow:
+						Pop(stack);
+						Pop(stack);
+						Push(stack, ValueType::Any);
+						break;
+					case Opcode::TestLt:
+					case Opcode::TestLe:
+					case Opcode::TestEq:
+					case Opcode::TestNe:
+					case Opcode::TestGe:
+					case Opcode::TestGt:
+						Pop(stack);
+						Pop(stack);
+						Push(stack, ValueType::Bool);
+						break;
+					case Opcode::And:
+					case Opcode::Or: {
+						StackValue left = Pop(stack);
+						StackValue right = Pop(stack);
+						Push(stack, left.type == ValueType::Bool && right.type == ValueType::Bool ? ValueType::Bool : ValueType::Any);
+						break;
+					}
+					case Opcode::Not:
+						Pop(stack);
+						Push(stack, ValueType::Bool);
+						break;
+					case Opcode::CastToBool:
+						// A comparison already yields a bool.
+						if(rewrite && !stack.empty() && stack.back().type == ValueType::Bool) {
+							removed[i] = true;
+						}
+						Pop(stack);
+						Push(stack, ValueType::Bool);
+						break;
+					case Opcode::CastToInt:
+						Pop(stack);
+						Push(stack, ValueType::Int);
+						break;
+					case Opcode::CastToString:
+						Pop(stack);
+						Push(stack, ValueType::String);
+						break;
+					case Opcode::GetStatic:
+						Pop(stack);
+						Push(stack, ValueType::Any);
+						break;
+					case Opcode::GetField:
+					case Opcode::GetArrayElement:
+						Pop(stack);
+						Pop(stack);
+						Push(stack, ValueType::Any);
+						break;
+					case Opcode::SetField:
+					case Opcode::SetArrayElement:
+						Pop(stack);
+						Pop(stack);
+						Pop(stack);
+						break;
+					case Opcode::Call:
+					case Opcode::CallField: {
+						long long n = op.operands[0].GetI64() + (op.opcode == Opcode::Call ? 2 : 3);
+						for(long long k = 0; k < n; k++) Pop(stack);
+						Push(stack, ValueType::Any);
+						break;
+					}
+					case Opcode::ConditionalBranch:
+					case Opcode::Return:
+						Pop(stack);
+						break;
+					case Opcode::InitLocal:
+					case Opcode::Branch:
+						break;
+					default:
+						// Unknown stack effect; stop reasoning about this block.
+						stack.clear();
+						break;
+				}
+			}
+
+			if(rewrite) {
+				std::size_t out = 0;
+				for(std::size_t i = 0; i < ops.size(); i++) {
+					if(!removed[i]) {
+						ops[out++] = ops[i];
+					}
+				}
+				ops.erase(ops.begin() + out, ops.end());
+			}
+		}
+
+	public:
+		static void Run(std::vector<BasicBlockWriter>& blocks) {
+			std::vector<ValueType> locals;
+
+			// Types only move up the lattice, so this terminates quickly.
+			std::vector<ValueType> last;
+			do {
+				last = locals;
+				for(auto& bb : blocks) {
+					RunBlock(bb.opcodes, locals, false);
+				}
+			} while(locals != last);
+
+			for(auto& bb : blocks) {
+				RunBlock(bb.opcodes, locals, true);
+			}
+		}
+	};
+
+	// Cleans up the control flow graph of a function: branches are threaded
+	// through blocks that only jump elsewhere, unreachable blocks are
+	// dropped, a block is merged into its only predecessor when that one
+	// jumps straight to it, and the blocks left are renumbered. Block 0
+	// stays the entry block.
+	class ControlFlowSimplifier {
+	private:
+		typedef std::vector<BasicBlockWriter> Blocks;
+
+		static bool IsTrivialJump(const BasicBlockWriter& bb) {
+			return bb.opcodes.size() == 1 && bb.opcodes[0].opcode == Opcode::Branch;
+		}
+
+		static long long ResolveTarget(const Blocks& blocks, long long target) {
+			// Bounded, so a cycle of empty jumps is left alone.
+			for(std::size_t steps = 0; steps < blocks.size(); steps++) {
+				if(target <= 0 || target >= (long long) blocks.size() || !IsTrivialJump(blocks[target])) {
+					break;
+				}
+				long long next = blocks[target].opcodes[0].operands[0].GetI64();
+				if(next == target) {
+					break;
+				}
+				target = next;
+			}
+			return target;
+		}
+
+		static void Successors(const BasicBlockWriter& bb, std::vector<long long>& out) {
+			out.clear();
+			if(bb.opcodes.empty()) {
+				return;
+			}
+			const BytecodeOp& last = bb.opcodes.back();
+			if(last.opcode == Opcode::Branch) {
+				out.push_back(last.operands[0].GetI64());
+			} else if(last.opcode == Opcode::ConditionalBranch) {
+				out.push_back(last.operands[0].GetI64());
+				out.push_back(last.operands[1].GetI64());
+			}
+		}
+
+		static void ThreadJumps(Blocks& blocks) {
+			for(auto& bb : blocks) {
+				if(bb.opcodes.empty()) {
+					continue;
+				}
+				BytecodeOp& last = bb.opcodes.back();
+				if(last.opcode == Opcode::Branch) {
+					last = BytecodeOp(Opcode::Branch, Operand::I64(ResolveTarget(blocks, last.operands[0].GetI64())));
+				} else if(last.opcode == Opcode::ConditionalBranch) {
+					long long if_true = ResolveTarget(blocks, last.operands[0].GetI64());
+					long long if_false = ResolveTarget(blocks, last.operands[1].GetI64());
+					if(if_true == if_false) {
+						last = BytecodeOp(Opcode::Pop);
+						bb.opcodes.push_back(BytecodeOp(Opcode::Branch, Operand::I64(if_true)));
+					} else {
+						last = BytecodeOp(Opcode::ConditionalBranch, Operand::I64(if_true), Operand::I64(if_false));
+					}
+				}
+			}
+		}
+
+		static std::vector<bool> FindReachable(const Blocks& blocks) {
+			std::vector<bool> reachable(blocks.size(), false);
+			std::vector<long long> pending { 0 }, succ;
+			while(!pending.empty()) {
+				long long b = pending.back();
+				pending.pop_back();
+				if(b < 0 || b >= (long long) blocks.size() || reachable[b]) {
+					continue;
+				}
+				reachable[b] = true;
+				Successors(blocks[b], succ);
+				pending.insert(pending.end(), succ.begin(), succ.end());
+			}
+			return reachable;
+		}
+
+		static void MergeStraightLines(Blocks& blocks, std::vector<bool>& alive) {
+			std::vector<std::size_t> n_preds(blocks.size(), 0);
+			std::vector<long long> succ;
+			for(std::size_t b = 0; b < blocks.size(); b++) {
+				if(!alive[b]) continue;
+				Successors(blocks[b], succ);
+				for(long long s : succ) {
+					if(s >= 0 && s < (long long) blocks.size()) n_preds[s]++;
+				}
+			}
+
+			for(std::size_t b = 0; b < blocks.size(); b++) {
+				if(!alive[b]) continue;
+				auto& ops = blocks[b].opcodes;
+				while(!ops.empty() && ops.back().opcode == Opcode::Branch) {
+					long long target = ops.back().operands[0].GetI64();
+					if(target <= 0 || target >= (long long) blocks.size() || target == (long long) b || n_preds[target] != 1) {
+						break;
+					}
+					ops.pop_back();
+					auto& tail = blocks[target].opcodes;
+					ops.insert(ops.end(), tail.begin(), tail.end());
+					tail.clear();
+					alive[target] = false;
+				}
+			}
+		}
+
+		static void Renumber(Blocks& blocks, const std::vector<bool>& alive) {
+			std::vector<long long> new_id(blocks.size(), -1);
+			long long next_id = 0;
+			for(std::size_t b = 0; b < blocks.size(); b++) {
+				if(alive[b]) new_id[b] = next_id++;
+			}
+
+			Blocks result;
+			result.reserve(next_id);
+			for(std::size_t b = 0; b < blocks.size(); b++) {
+				if(!alive[b]) continue;
+				auto& ops = blocks[b].opcodes;
+				if(!ops.empty()) {
+					BytecodeOp& last = ops.back();
+					if(last.opcode == Opcode::Branch) {
+						last = BytecodeOp(Opcode::Branch, Operand::I64(new_id[last.operands[0].GetI64()]));
+					} else if(last.opcode == Opcode::ConditionalBranch) {
+						last = BytecodeOp(
+							Opcode::ConditionalBranch,
+							Operand::I64(new_id[last.operands[0].GetI64()]),
+							Operand::I64(new_id[last.operands[1].GetI64()])
+						);
+					}
+				}
+				result.push_back(std::move(blocks[b]));
+			}
+			blocks = std::move(result);
+		}
+
+	public:
+		static void Run(Blocks& blocks) {
+			if(blocks.empty()) {
+				return;
+			}
+			ThreadJumps(blocks);
+			std::vector<bool> alive = FindReachable(blocks);
+			MergeStraightLines(blocks, alive);
+			Renumber(blocks, alive);
+		}
+	};
+
+	// Renumbers locals so that ones which are never live at the same time
+	// share a slot, and shrinks InitLocal to the slots that are left.
+	// Runs after type inference, which types each slot as a whole.
+	class LocalAllocator {
+	private:
+		static void Successors(const BasicBlockWriter& bb, std::vector<std::size_t>& out) {
+			out.clear();
+			if(bb.opcodes.empty()) {
+				return;
+			}
+			const BytecodeOp& last = bb.opcodes.back();
+			if(last.opcode == Opcode::Branch) {
+				out.push_back(last.operands[0].GetI64());
+			} else if(last.opcode == Opcode::ConditionalBranch) {
+				out.push_back(last.operands[0].GetI64());
+				out.push_back(last.operands[1].GetI64());
+			}
+		}
+
+	public:
+		static void Run(std::vector<BasicBlockWriter>& blocks) {
+			if(blocks.empty() || blocks[0].opcodes.empty() || blocks[0].opcodes[0].opcode != Opcode::InitLocal) {
+				return;
+			}
+			std::size_t n_locals = blocks[0].opcodes[0].operands[0].GetI64();
+			for(auto& bb : blocks) {
+				for(auto& op : bb.opcodes) {
+					if(op.opcode == Opcode::GetLocal || op.opcode == Opcode::SetLocal) {
+						n_locals = std::max(n_locals, (std::size_t) op.operands[0].GetI64() + 1);
+					}
+				}
+			}
+			if(n_locals < 2) {
+				return;
+			}
+
+			// Backward liveness: a local is live-in if it is read before it
+			// is written in the block, or live-out and not written.
+			std::size_t n_blocks = blocks.size();
+			std::vector<std::vector<bool>> live_in(n_blocks, std::vector<bool>(n_locals, false));
+			std::vector<std::vector<bool>> live_out(n_blocks, std::vector<bool>(n_locals, false));
+			std::vector<std::vector<std::size_t>> succ(n_blocks);
+			for(std::size_t b = 0; b < n_blocks; b++) {
+				Successors(blocks[b], succ[b]);
+			}
+
+			bool changed = true;
+			while(changed) {
+				changed = false;
+				for(std::size_t b = n_blocks; b-- > 0; ) {
+					std::vector<bool> live(n_locals, false);
+					for(std::size_t s : succ[b]) {
+						if(s >= n_blocks) continue;
+						for(std::size_t i = 0; i < n_locals; i++) {
+							if(live_in[s][i]) live[i] = true;
+						}
+					}
+					live_out[b] = live;
+					auto& ops = blocks[b].opcodes;
+					for(std::size_t i = ops.size(); i-- > 0; ) {
+						if(ops[i].opcode == Opcode::SetLocal) {
+							live[ops[i].operands[0].GetI64()] = false;
+						} else if(ops[i].opcode == Opcode::GetLocal) {
+							live[ops[i].operands[0].GetI64()] = true;
+						}
+					}
+					if(live != live_in[b]) {
+						live_in[b] = std::move(live);
+						changed = true;
+					}
+				}
+			}
+
+			// Two locals interfere if one is written while the other is live.
+			std::vector<std::vector<bool>> interferes(n_locals, std::vector<bool>(n_locals, false));
+			for(std::size_t b = 0; b < n_blocks; b++) {
+				std::vector<bool> live = live_out[b];
+				auto& ops = blocks[b].opcodes;
+				for(std::size_t i = ops.size(); i-- > 0; ) {
+					if(ops[i].opcode == Opcode::SetLocal) {
+						std::size_t x = ops[i].operands[0].GetI64();
+						for(std::size_t y = 0; y < n_locals; y++) {
+							if(live[y] && y != x) {
+								interferes[x][y] = interferes[y][x] = true;
+							}
+						}
+						live[x] = false;
+					} else if(ops[i].opcode == Opcode::GetLocal) {
+						live[ops[i].operands[0].GetI64()] = true;
+					}
+				}
+			}
+
+			// Locals read before any write rely on InitLocal having set them
+			// to null, so nothing else may ever be stored in their slot.
+			for(std::size_t x = 0; x < n_locals; x++) {
+				if(live_in[0][x]) {
+					for(std::size_t y = 0; y < n_locals; y++) {
+						if(y != x) interferes[x][y] = interferes[y][x] = true;
+					}
+				}
+			}
+
+			std::vector<long long> slot(n_locals, -1);
+			long long n_slots = 0;
+			std::vector<bool> taken;
+			for(std::size_t x = 0; x < n_locals; x++) {
+				taken.assign(n_slots, false);
+				for(std::size_t y = 0; y < x; y++) {
+					if(interferes[x][y]) taken[slot[y]] = true;
+				}
+				long long s = 0;
+				while(s < n_slots && taken[s]) s++;
+				if(s == n_slots) n_slots++;
+				slot[x] = s;
+			}
+
+			blocks[0].opcodes[0] = BytecodeOp(Opcode::InitLocal, Operand::I64(n_slots));
+			for(auto& bb : blocks) {
+				for(auto& op : bb.opcodes) {
+					if(op.opcode == Opcode::GetLocal || op.opcode == Opcode::SetLocal) {
+						op = BytecodeOp(op.opcode, Operand::I64(slot[op.operands[0].GetI64()]));
+					}
+				}
+			}
+		}
+	};
+
 	class FunctionWriter {
 	private:
         std::vector<BasicBlockWriter> basic_blocks;
         std::function<void (std::vector<BasicBlockWriter>&)> user_translator;
 
-		// https://stackoverflow.com/questions/7724448/simple-json-string-escape-for-c/33799784#33799784
-		static std::string escape_json(const std::string& s) {
-			std::ostringstream o;
-			for (auto c = s.cbegin(); c != s.cend(); c++) {
-				if (*c == '"' || *c == '\\' || ('\x00' <= *c && *c <= '\x1f')) {
-					o << "\\u"
-					  << std::hex << std::setw(4) << std::setfill('0') << (int)*c;
+		// Same escaping as https://stackoverflow.com/questions/7724448/simple-json-string-escape-for-c/33799784#33799784,
+		// without a stream per string.
+		static void write_escaped(std::string& output, const std::string& s) {
+			static const char hex_digits[] = "0123456789abcdef";
+
+			for(char c : s) {
+				if (c == '"' || c == '\\' || ('\x00' <= c && c <= '\x1f')) {
+					output += "\\u00";
+					output += hex_digits[(c >> 4) & 0xf];
+					output += hex_digits[c & 0xf];
 				} else {
-					o << *c;
+					output += c;
 				}
 			}
-			return o.str();
 		}
 
-		static std::string operand_to_string(const Operand& operand) {
-			std::ostringstream o;
-			
+		static void write_operand(std::string& output, const Operand& operand) {
+			char buf[32];
+
 			switch(operand.type) {
 				case OperandType::i64_:
-					o << operand.i64_value;
+					output.append(buf, std::snprintf(buf, sizeof(buf), "%lld", operand.i64_value));
 					break;
-				case OperandType::f64_:
-					o << operand.f64_value;
+				case OperandType::f64_: {
+					// Shortest form that still reads back as the same double.
+					int len = std::snprintf(buf, sizeof(buf), "%.15g", operand.f64_value);
+					if(std::strtod(buf, nullptr) != operand.f64_value) {
+						len = std::snprintf(buf, sizeof(buf), "%.17g", operand.f64_value);
+					}
+					output.append(buf, len);
 					break;
+				}
 				case OperandType::string_:
-					o << "\"" << escape_json(operand.string_value) << "\"";
+					output += '"';
+					write_escaped(output, *operand.string_value);
+					output += '"';
 					break;
 				case OperandType::bool_:
-					o << (operand.bool_value ? "true" : "false");
+					output += operand.bool_value ? "true" : "false";
 					break;
 				default:
-					throw 0;
+					throw std::runtime_error("Unknown operand type");
+			}
+		}
+
+		static void write_op(std::string& output, const BytecodeOp& op) {
+			if(op.n_operands == 0) {
+				output += '"';
+				output += op.Name();
+				output += '"';
+				return;
+			}
+
+			output += "{\"";
+			output += op.Name();
+			output += "\":";
+
+			if(op.n_operands == 1) {
+				write_operand(output, op.operands[0]);
+			} else {
+				output += '[';
+				for(int i = 0; i < op.n_operands; i++) {
+					if(i != 0) {
+						output += ',';
+					}
+					write_operand(output, op.operands[i]);
+				}
+				output += ']';
 			}
 
-			return o.str();
+			output += '}';
 		}
 
     public:
@@ -188,11 +1115,28 @@ namespace assembly_writer {
             basic_blocks.push_back(bb.Clone());
             return *this;
         }
-        
+
+		FunctionWriter& Write(BasicBlockWriter&& bb) {
+            basic_blocks.push_back(std::move(bb));
+            return *this;
+        }
+
+		// Runs a whole-function pass over the blocks written so far.
+		FunctionWriter& Transform(const std::function<void (std::vector<BasicBlockWriter>&)>& pass) {
+			pass(basic_blocks);
+			return *this;
+		}
+
+		// Runs the user translator once; later calls are no-ops.
+		void Translate() {
+			if(user_translator != nullptr) {
+				user_translator(basic_blocks);
+				user_translator = nullptr;
+			}
+		}
+
         ort::Function Build() {
-            if(user_translator != nullptr) {
-                user_translator(basic_blocks);
-            }
+            Translate();
 
             std::string code = ToJson();
 
@@ -203,67 +1147,32 @@ namespace assembly_writer {
             );
         }
 
-		std::string ToJson() {
-			std::string output;
-
-			output += "{\"basic_blocks\":";
+		std::string ToJson() const {
+			std::size_t n_ops = 0;
+			for(auto& bb : basic_blocks) {
+				n_ops += bb.opcodes.size();
+			}
 
-			output += "[";
+			std::string output;
+			output.reserve(32 + basic_blocks.size() * 16 + n_ops * 24);
 
-			bool is_first_bb = true;
+			output += "{\"basic_blocks\":[";
 
-			for (auto& bb : basic_blocks) {
-				if(is_first_bb) {
-					is_first_bb = false;
-				} else {
-					output += ",";
+			for(std::size_t i = 0; i < basic_blocks.size(); i++) {
+				if(i != 0) {
+					output += ',';
 				}
 
-				output += "{\"opcodes\":";
+				output += "{\"opcodes\":[";
 
-				output += "[";
-				
-				bool is_first = true;
-	
-				for(auto& op : bb.opcodes) {
-					if(is_first) {
-						is_first = false;
-					} else {
-						output += ",";
-					}
-	
-					if(op.operands.size() == 0) {
-						output += "\"";
-						output += escape_json(op.name);
-						output += "\"";
-					} else {
-						output += "{\"";
-						output += escape_json(op.name);
-						output += "\":";
-	
-						if(op.operands.size() == 1) {
-							output += operand_to_string(op.operands[0]);
-						} else {
-							output += "[";
-	
-							bool inner_first = true;
-							for(auto& iop : op.operands) {
-								if(inner_first) {
-									inner_first = false;
-								} else {
-									output += ",";
-								}
-	
-								output += operand_to_string(iop);
-							}
-	
-							output += "]";
-						}
-	
-						output += "}";
+				auto& opcodes = basic_blocks[i].opcodes;
+				for(std::size_t j = 0; j < opcodes.size(); j++) {
+					if(j != 0) {
+						output += ',';
 					}
+					write_op(output, opcodes[j]);
 				}
-	
+
 				output += "]}";
 			}
 
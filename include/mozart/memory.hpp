@@ -154,6 +154,39 @@ namespace cov {
 		}
 	};
 
+	template<typename _Tp = void>
+	struct _pool_helper {
+		static std::atomic<std::size_t> shared_count;
+	};
+	template<typename _Tp>
+	std::atomic<std::size_t> _pool_helper<_Tp>::shared_count(0);
+
+/*
+* Pools of cov::allocator are not thread-safe.
+* While any concurrent_allocation is alive, every allocator bypasses its pool and
+* goes straight to the underlying allocator, so other threads may allocate safely.
+* Guards must be created and destroyed while no other thread is allocating.
+*/
+	class concurrent_allocation final {
+	public:
+		concurrent_allocation()
+		{
+			++_pool_helper<>::shared_count;
+		}
+
+		concurrent_allocation(const concurrent_allocation &) = delete;
+
+		~concurrent_allocation()
+		{
+			--_pool_helper<>::shared_count;
+		}
+
+		static bool active()
+		{
+			return _pool_helper<>::shared_count.load(std::memory_order_relaxed) != 0;
+		}
+	};
+
 	template<typename T, long blck_size, template<typename> class allocator_t=std::allocator>
 	class allocator final {
 		allocator_t<T> mAlloc;
@@ -196,7 +229,7 @@ namespace cov {
 		T *alloc(ArgsT &&...args)
 		{
 			T *ptr = nullptr;
-			if (mOffset >= 0)
+			if (mOffset >= 0 && !concurrent_allocation::active())
 				ptr = mPool[mOffset--];
 			else
 				ptr = mAlloc.allocate(1);
@@ -207,7 +240,7 @@ namespace cov {
 		void free(T *ptr)
 		{
 			mAlloc.destroy(ptr);
-			if (mOffset < blck_size - 1)
+			if (mOffset < blck_size - 1 && !concurrent_allocation::active())
 				mPool[++mOffset] = ptr;
 			else
 				mAlloc.deallocate(ptr, 1);
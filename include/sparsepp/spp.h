@@ -4396,6 +4396,14 @@ namespace spp_ {
 			return rep.template find_or_insert<DefaultValue>(key).second;
 		}
 
+		// Like operator[], but the entry inserted for a missing key is made by
+		// DefaultFcn, a functor that takes the key and returns a value_type.
+		template<class DefaultFcn>
+		value_type &find_or_insert(const key_type &key)
+		{
+			return rep.template find_or_insert<DefaultFcn>(key);
+		}
+
 		size_type count(const key_type &key) const
 		{
 			return rep.count(key);
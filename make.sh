@@ -22,8 +22,8 @@ function set_flag() {
 }
 
 DEFAULT_PREFIX="/usr"
-DEFAULT_CXXFLAGS="-std=c++11 -I ../include -fPIE -s -O3 -ldl"
-DEFAULT_LDFLAGS="-ldl"
+DEFAULT_CXXFLAGS="-std=c++11 -I ../include -fPIE -s -O3 -pthread -ldl"
+DEFAULT_LDFLAGS="-pthread -ldl"
 DEFAULT_CXX=g++
 
 set_flag CXX $DEFAULT_CXX
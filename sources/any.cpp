@@ -3,6 +3,7 @@
 #include <covscript/runtime.hpp>
 #include <hexagon/ort.h>
 #include <vector>
+#include <memory>
 #include <iostream>
 
 namespace cs_impl {
@@ -28,7 +29,10 @@ namespace cs_impl {
                 ort::Runtime& rt = *cs::get_active_runtime();
 
                 if(v.IsString(rt)) {
-                    return any(v.ToString(rt));
+                    // Read straight into the string the result holds.
+                    any str = any::make<std::string>();
+                    v.ReadString(rt, str.val<std::string>(true));
+                    return str;
                 } else {
                     ort::ObjectHandle handle = v.ToObjectHandle(*cs::get_active_runtime());
                     return *dynamic_cast<any *>(handle.ToProxiedObject());
@@ -56,29 +60,135 @@ namespace cs_impl {
             return ort::Value::FromString(const_val<std::string>(), *cs::get_active_runtime());
         } else if(v_type == typeid(bool)) {
             return ort::Value::FromBool(const_val<bool>());
-        } else {
+        } else if(mDat == nullptr) {
             return ort::ObjectProxy(new any(*this)).Pin(*cs::get_active_runtime());
+        } else {
+            // The HVM destroys the owner when it collects the object, which
+            // removes it from the cache (see ~any).
+            ort::Runtime *rt = cs::get_active_runtime();
+            if(mDat->hvm_cache == nullptr)
+                mDat->hvm_cache = new hvm_object_cache();
+            hvm_object *obj = mDat->hvm_cache->find(rt);
+            if(obj == nullptr) {
+                any *owner = new any(*this);
+                HxOrtValue handle = ort::ObjectProxy(owner).Pin(*rt).Extract();
+                mDat->hvm_cache->objects.push_back(hvm_object {rt, owner, handle, {}});
+                obj = &mDat->hvm_cache->objects.back();
+            }
+            return ort::Value(obj->handle);
+        }
+    }
+
+    static any& unwrap_hvm_object(const ort::Value& v) {
+        ort::Runtime& rt = *cs::get_active_runtime();
+        if(v.Type() != ort::ValueType::Object || v.IsString(rt)) {
+            throw cs::lang_error("Access non-array or hash map object by index.");
+        }
+        any *obj = dynamic_cast<any *>(v.ToObjectHandle(rt).ToProxiedObject());
+        if(obj == nullptr) {
+            throw cs::lang_error("Access non-array or hash map object by index.");
+        }
+        return *obj;
+    }
+
+    ort::Value any::hvm_get_element(const ort::Value& target, const ort::Value& key) {
+        any& obj = unwrap_hvm_object(target);
+        any elem;
+        if(obj.type() == typeid(cs::array)) {
+            if(key.Type() == ort::ValueType::Int)
+                elem = obj.const_val<cs::array>().at(key.ExtractI64());
+            else if(key.Type() == ort::ValueType::Float)
+                elem = obj.const_val<cs::array>().at(key.ExtractF64());
+            else
+                throw cs::lang_error("Index of array must be a number.");
+        } else if(obj.type() == typeid(cs::hash_map)) {
+            elem = obj.const_val<cs::hash_map>().at(from_hvm_value(key));
+        } else if(obj.type() == typeid(cs::string_map)) {
+            elem = obj.const_val<cs::string_map>().at(string_map_cs_ext::key_of(from_hvm_value(key)));
+        } else {
+            cs::vector args {obj, from_hvm_value(key)};
+            elem = obj.get_ext()->get_var("__get__").const_val<cs::callable>().call(args);
+        }
+        return elem.to_hvm_value();
+    }
+
+    void any::hvm_set_element(const ort::Value& target, const ort::Value& key, const ort::Value& value) {
+        any& obj = unwrap_hvm_object(target);
+        if(obj.type() == typeid(cs::array)) {
+            cs::array& arr = obj.val<cs::array>(true);
+            if(key.Type() == ort::ValueType::Int)
+                arr.at(key.ExtractI64()) = from_hvm_value(value);
+            else if(key.Type() == ort::ValueType::Float)
+                arr.at(key.ExtractF64()) = from_hvm_value(value);
+            else
+                throw cs::lang_error("Index of array must be a number.");
+        } else if(obj.type() == typeid(cs::hash_map)) {
+            cs::hash_map& map = obj.val<cs::hash_map>(true);
+            any k = from_hvm_value(key);
+            auto it = map.find(k);
+            if(it != map.end())
+                it->second.swap(cs::copy(from_hvm_value(value)), true);
+            else
+                map.emplace(cs::copy(k), cs::copy(from_hvm_value(value)));
+        } else if(obj.type() == typeid(cs::string_map)) {
+            string_map_cs_ext::insert(obj.val<cs::string_map>(true), from_hvm_value(key), from_hvm_value(value));
+        } else {
+            cs::vector args {obj, from_hvm_value(key), from_hvm_value(value)};
+            obj.get_ext()->get_var("__set__").const_val<cs::callable>().call(args);
         }
     }
 
-    ort::Value any::Call(const std::vector<ort::Value>& args) {
+    // Argument vectors for calls from HVM code. They are reused so that a
+    // call does not allocate; calls nest (HVM -> native -> HVM -> native),
+    // so every active call takes its own vector from the pool.
+    class hvm_call_arguments {
+        static std::vector<std::unique_ptr<cs::vector>>& pool() {
+            static std::vector<std::unique_ptr<cs::vector>> free_args;
+            return free_args;
+        }
+
+        std::unique_ptr<cs::vector> args;
+    public:
+        hvm_call_arguments() {
+            auto& free_args = pool();
+            if(free_args.empty()) {
+                args.reset(new cs::vector());
+            } else {
+                args = std::move(free_args.back());
+                free_args.pop_back();
+            }
+        }
+
+        hvm_call_arguments(const hvm_call_arguments&) = delete;
+
+        ~hvm_call_arguments() {
+            args->clear();
+            pool().push_back(std::move(args));
+        }
+
+        cs::vector& get() {
+            return *args;
+        }
+    };
+
+    ort::Value any::Call(const ort::ArgumentList& args) {
         try {
             if(type() == typeid(cs::callable)) {
-                std::vector<any> call_args;
-                call_args.reserve(args.size());
-                for(auto& v : args) {
-                    call_args.push_back(from_hvm_value(v));
+                hvm_call_arguments buffer;
+                cs::vector& call_args = buffer.get();
+                for(unsigned int i = 0; i < args.size(); i++) {
+                    call_args.push_back(from_hvm_value(args[i]));
                 }
                 auto ret = const_val<cs::callable>().call(call_args);
                 return ret.to_hvm_value();
             } else if(type() == typeid(cs::object_method)) {
-                auto m = const_val<cs::object_method>();
+                const auto& m = const_val<cs::object_method>();
 
-                std::vector<any> call_args;
-                call_args.reserve(args.size() + 1);
+                hvm_call_arguments buffer;
+                cs::vector& call_args = buffer.get();
                 call_args.push_back(m.object);
-                for(auto& v : args) {
-                    call_args.push_back(from_hvm_value(v));
+                for(unsigned int i = 0; i < args.size(); i++) {
+                    call_args.push_back(from_hvm_value(args[i]));
                 }
 
                 auto ret = m.callable.const_val<cs::callable>().call(call_args);
@@ -96,6 +206,22 @@ namespace cs_impl {
         }
     }
 
+    // Members of containers and output streams with a native HVM
+    // implementation (see bind_hvm_method in the extensions).
+    static bool bind_hvm_native_method(const any& self, const char *name, ort::Value& method) {
+        ort::Runtime& rt = *cs::get_active_runtime();
+        const std::type_info& t = self.type();
+        if(t == typeid(cs::array))
+            return array_cs_ext::bind_hvm_method(self, name, rt, method);
+        else if(t == typeid(cs::list))
+            return list_cs_ext::bind_hvm_method(self, name, rt, method);
+        else if(t == typeid(cs::hash_map))
+            return hash_map_cs_ext::bind_hvm_method(self, name, rt, method);
+        else if(t == typeid(cs::ostream))
+            return ostream_cs_ext::bind_hvm_method(self, name, rt, method);
+        return false;
+    }
+
     ort::Value any::GetField(const char *name) {
         try {
             if(type() == typeid(cs::extension_t)) {
@@ -104,9 +230,31 @@ namespace cs_impl {
                 return val<cs::type>(true).get_var(name).to_hvm_value();
             } else {
                 any &v = get_ext()->get_var(name);
-                if (v.type() == typeid(cs::callable))
-                    return any::make_protect<cs::object_method>(*this, v, v.const_val<cs::callable>().is_constant()).to_hvm_value();
-                else
+                if (v.type() == typeid(cs::callable)) {
+                    // Bind a method once per object and type. A binding for
+                    // another type is left over from before an assignment
+                    // swapped this value, and is replaced.
+                    const std::type_info &t = type();
+                    hvm_object *obj = mDat != nullptr && mDat->hvm_cache != nullptr ? mDat->hvm_cache->find_owner(this) : nullptr;
+                    if(obj != nullptr) {
+                        auto it = obj->methods.find(name);
+                        if(it != obj->methods.end() && *it->second.first == t)
+                            return ort::Value(it->second.second);
+                    }
+                    ort::Value method = ort::Value::Null();
+                    if(!bind_hvm_native_method(*this, name, method))
+                        method = any::make_protect<cs::object_method>(*this, v, v.const_val<cs::callable>().is_constant()).to_hvm_value();
+                    // Binding may pin objects and let the runtime collect
+                    // others, so the entry is looked up again.
+                    obj = obj != nullptr ? mDat->hvm_cache->find_owner(this) : nullptr;
+                    if(obj != nullptr) {
+                        // The hidden field keeps the method alive as long as
+                        // the object; GetField still sees every access to name.
+                        SetStaticField(std::string("__bound_method__") + name, method);
+                        obj->methods[name] = std::make_pair(&t, method.Extract());
+                    }
+                    return method;
+                } else
                     return v.to_hvm_value();
             }
         } catch(const cs::lang_error& e) {
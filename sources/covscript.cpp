@@ -71,22 +71,32 @@ namespace cs {
 		a.swap(b, true);
 	}
 
+	static void init_ext_lazily(void (*init)(), std::initializer_list<extension *> exts)
+	{
+		std::shared_ptr<lazy_initializer> initializer = std::make_shared<lazy_initializer>(init);
+		for (auto &ext:exts)
+			ext->set_initializer(initializer);
+	}
+
 	void init_ext()
 	{
-		// Init the extensions
-		iostream_cs_ext::init();
-		istream_cs_ext::init();
-		ostream_cs_ext::init();
-		system_cs_ext::init();
-		runtime_cs_ext::init();
-		except_cs_ext::init();
-		char_cs_ext::init();
-		string_cs_ext::init();
-		list_cs_ext::init();
-		array_cs_ext::init();
-		pair_cs_ext::init();
-		hash_map_cs_ext::init();
-		math_cs_ext::init();
+		// Init the extensions on their first access
+		init_ext_lazily(iostream_cs_ext::init, {&iostream_ext, &seekdir_ext, &openmode_ext});
+		init_ext_lazily(istream_cs_ext::init, {&istream_ext});
+		init_ext_lazily(ostream_cs_ext::init, {&ostream_ext});
+		init_ext_lazily(system_cs_ext::init,
+		                {&system_ext, &console_ext, &file_ext, &path_ext, &path_type_ext, &path_info_ext});
+		init_ext_lazily(runtime_cs_ext::init, {&runtime_ext, &context_ext});
+		init_ext_lazily(except_cs_ext::init, {&except_ext});
+		init_ext_lazily(char_cs_ext::init, {&char_ext});
+		init_ext_lazily(string_cs_ext::init, {&string_ext});
+		init_ext_lazily(string_builder_cs_ext::init, {&string_builder_ext});
+		init_ext_lazily(list_cs_ext::init, {&list_ext, &list_iterator_ext});
+		init_ext_lazily(array_cs_ext::init, {&array_ext, &array_iterator_ext});
+		init_ext_lazily(pair_cs_ext::init, {&pair_ext});
+		init_ext_lazily(hash_map_cs_ext::init, {&hash_map_ext});
+		init_ext_lazily(string_map_cs_ext::init, {&string_map_ext});
+		init_ext_lazily(math_cs_ext::init, {&math_ext});
 	}
 
 	void instance_type::init_runtime_no_vm()
@@ -104,6 +114,8 @@ namespace cs {
 		                         cs_impl::hash<std::string>(typeid(pointer).name()));
 		storage.add_buildin_type("string", []() -> var { return var::make<string>(); },
 		                         cs_impl::hash<std::string>(typeid(string).name()), string_ext_shared);
+		storage.add_buildin_type("string_builder", []() -> var { return var::make<string_builder>(); },
+		                         cs_impl::hash<std::string>(typeid(string_builder).name()), string_builder_ext_shared);
 		storage.add_buildin_type("list", []() -> var { return var::make<list>(); },
 		                         cs_impl::hash<std::string>(typeid(list).name()), list_ext_shared);
 		storage.add_buildin_type("array", []() -> var { return var::make<array>(); },
@@ -112,6 +124,8 @@ namespace cs {
 		                         cs_impl::hash<std::string>(typeid(pair).name()), pair_ext_shared);
 		storage.add_buildin_type("hash_map", []() -> var { return var::make<hash_map>(); },
 		                         cs_impl::hash<std::string>(typeid(hash_map).name()), hash_map_ext_shared);
+		storage.add_buildin_type("string_map", []() -> var { return var::make<string_map>(); },
+		                         cs_impl::hash<std::string>(typeid(string_map).name()), string_map_ext_shared);
 		// Add Internal Functions to storage
 		storage.add_buildin_var("to_integer", cs::var::make_protect<cs::callable>(cs::cni(to_integer), true));
 		storage.add_buildin_var("to_string", cs::var::make_protect<cs::callable>(cs::cni(to_string), true));
@@ -24,6 +24,8 @@
 #include <covscript/runtime.hpp>
 #include <hexagon/ort.h>
 #include <hexagon/ort_assembly_writer.h>
+#include <sys/stat.h>
+#include <cstdlib>
 #include <vector>
 #include <iostream>
 
@@ -47,6 +49,7 @@ namespace cs {
 		if(enable_hvm) {
 			run_in_hexagon_vm(debug, compile_only);
 		} else {
+			hvm_tier_debug = debug;
 			if(!compile_only) {
 				interpret();
 			}
@@ -63,45 +66,49 @@ namespace cs {
 		ort::Value registry_proxy_inst = ort::ObjectProxy(registry).Pin(rt);
 
 		igniter_bb
-			.Write(BytecodeOp("GetArgument", Operand::I64(0))) // the registry
-			.Write(BytecodeOp("LoadString", Operand::String("new_dynamic")))
-			.Write(BytecodeOp("LoadNull"))
-			.Write(BytecodeOp("LoadString", Operand::String("__builtin")))
-			.Write(BytecodeOp("GetStatic"))
-			.Write(BytecodeOp("CallField", Operand::I64(1))) // the global environment
-			.Write(BytecodeOp("Dup"))
-			.Write(BytecodeOp("LoadString", Operand::String("__builtin")))
-			.Write(BytecodeOp("GetStatic"))
-			.Write(BytecodeOp("LoadString", Operand::String("builtin")))
-			.Write(BytecodeOp("Rotate3"))
-			.Write(BytecodeOp("SetField"));
+			.Write(BytecodeOp(Opcode::GetArgument, Operand::I64(0))) // the registry
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("new_dynamic")))
+			.Write(BytecodeOp(Opcode::LoadNull))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("__builtin")))
+			.Write(BytecodeOp(Opcode::GetStatic))
+			.Write(BytecodeOp(Opcode::CallField, Operand::I64(1))) // the global environment
+			.Write(BytecodeOp(Opcode::Dup))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("__builtin")))
+			.Write(BytecodeOp(Opcode::GetStatic))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("builtin")))
+			.Write(BytecodeOp(Opcode::Rotate3))
+			.Write(BytecodeOp(Opcode::SetField));
 
 		igniter_bb
-			.Write(BytecodeOp("Dup"))
-			.Write(BytecodeOp("LoadString", Operand::String("cs_to_string")))
-			.Write(BytecodeOp("GetStatic"))
-			.Write(BytecodeOp("LoadString", Operand::String("to_string")))
-			.Write(BytecodeOp("Rotate3"))
-			.Write(BytecodeOp("SetField"))
-			.Write(BytecodeOp("Dup"))
-			.Write(BytecodeOp("LoadString", Operand::String("cs_to_integer")))
-			.Write(BytecodeOp("GetStatic"))
-			.Write(BytecodeOp("LoadString", Operand::String("to_integer")))
-			.Write(BytecodeOp("Rotate3"))
-			.Write(BytecodeOp("SetField"));
+			.Write(BytecodeOp(Opcode::Dup))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("cs_to_string")))
+			.Write(BytecodeOp(Opcode::GetStatic))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("to_string")))
+			.Write(BytecodeOp(Opcode::Rotate3))
+			.Write(BytecodeOp(Opcode::SetField))
+			.Write(BytecodeOp(Opcode::Dup))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("cs_to_integer")))
+			.Write(BytecodeOp(Opcode::GetStatic))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("to_integer")))
+			.Write(BytecodeOp(Opcode::Rotate3))
+			.Write(BytecodeOp(Opcode::SetField));
 
 		igniter_bb
-			.Write(BytecodeOp("Dup"))
-			.Write(BytecodeOp("GetArgument", Operand::I64(0)))
-			.Write(BytecodeOp("LoadString", Operand::String("__global_registry")))
-			.Write(BytecodeOp("Rotate3"))
-			.Write(BytecodeOp("SetField"));
+			.Write(BytecodeOp(Opcode::Dup))
+			.Write(BytecodeOp(Opcode::GetArgument, Operand::I64(0)))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("__global_registry")))
+			.Write(BytecodeOp(Opcode::Rotate3))
+			.Write(BytecodeOp(Opcode::SetField));
 
 		igniter_bb
-			.Write(BytecodeOp("Return"));
+			.Write(BytecodeOp(Opcode::Return));
+
+		// Set once above and never reassigned by the igniter.
+		for(const char *name : {"builtin", "to_string", "to_integer", "__global_registry"})
+			registry -> fixed_globals.insert(name);
 
 		igniter.Write(
-			igniter_bb
+			std::move(igniter_bb)
 		);
 		auto igniter_fn = igniter.Build();
 		ort::Value igniter_inst = igniter_fn.Pin(rt);
@@ -118,45 +125,39 @@ namespace cs {
 		using namespace hexagon::assembly_writer;
 
 		hvm_runtime_guard rt_guard(&hvm_rt);
+		StringPoolScope string_pool;
 
 		// leak at exception ?
 		global_registry *registry = new global_registry();
 
-		registry -> add(
-			std::string("runtime"),
-			//ort::ObjectProxy(new var(make_shared_extension(runtime_ext))).Pin(hvm_rt)
-			ort::ObjectProxy(new runtime_ext_hvm_impl()).Pin(hvm_rt)
-		);
-		registry -> add(
-			std::string("system"),
-			ort::ObjectProxy(new var(make_shared_extension(system_ext))).Pin(hvm_rt)
-		);
-		registry -> add(
-			std::string("math"),
-			//ort::ObjectProxy(new var(make_shared_extension(math_ext))).Pin(hvm_rt)
-			ort::ObjectProxy(new math_ext_hvm_impl()).Pin(hvm_rt)
-		);
-		registry -> add(
-			std::string("iostream"),
-			ort::ObjectProxy(new var(make_shared_extension(iostream_ext))).Pin(hvm_rt)
-		);
-		registry -> add(
-			std::string("array"),
-			ort::ObjectProxy(new var(make_shared_extension(array_ext))).Pin(hvm_rt)
-		);
-		registry -> add(
-			std::string("hash_map"),
-			ort::ObjectProxy(new var(make_shared_extension(hash_map_ext))).Pin(hvm_rt)
-		);
+		// Every extension HVM code can name. runtime and math have native
+		// HVM versions of their members; `using` needs the member names while
+		// compiling, so the builder gets the same list.
+		const std::pair<const char *, extension *> builtin_extensions[] = {
+			{"runtime", &runtime_ext}, {"system", &system_ext}, {"math", &math_ext},
+			{"iostream", &iostream_ext}, {"array", &array_ext}, {"hash_map", &hash_map_ext},
+			{"string_map", &string_map_ext}, {"string_builder", &string_builder_ext}
+		};
+		function_builder builder;
+		for(auto& ext : builtin_extensions) {
+			ort::ProxiedObject *impl;
+			if(ext.second == &runtime_ext)
+				impl = new runtime_ext_hvm_impl();
+			else if(ext.second == &math_ext)
+				impl = new math_ext_hvm_impl();
+			else
+				impl = new extension_hvm_impl(make_shared_extension(*ext.second));
+			registry -> add(std::string(ext.first), ort::ObjectProxy(impl).Pin(hvm_rt));
+			builder.extensions.emplace(ext.first, make_shared_extension(*ext.second));
+		}
 
 		ort::Value global_env = build_global_env(hvm_rt, registry);
 
-		function_builder builder;
 		for(auto& stmt : statements) {
 			stmt -> generate_code(builder);
 		}
-		builder.get_current().Write(BytecodeOp("LoadNull"));
-		builder.get_current().Write(BytecodeOp("Return"));
+		builder.get_current().Write(BytecodeOp(Opcode::LoadNull));
+		builder.get_current().Write(BytecodeOp(Opcode::Return));
 		auto entry_fn = builder.build(hvm_rt, *registry, global_env, debug, enable_hvm_optimization);
 		ort::Value entry_inst = entry_fn.Pin(hvm_rt);
 
@@ -170,6 +171,93 @@ namespace cs {
 		hvm_rt.Invoke(entry_inst, std::vector<ort::Value>());
 	}
 
+	// Global environment of a function compiled in tiered mode. Functions
+	// defined in its body are static fields as in HVM mode; any other name
+	// is looked up in the interpreter storage when it is accessed, so the
+	// compiled code sees the same variables as the interpreted function.
+	class tiered_registry final : public global_registry {
+		context_t context;
+	public:
+		explicit tiered_registry(const context_t& c) : context(c) {}
+
+		virtual hexagon::ort::Value GetField(const char *name) override {
+			return context -> instance -> storage.get_var(name).to_hvm_value();
+		}
+	};
+
+	void instance_type::tier_up(const std::vector<std::string>& args, const std::deque<statement_base *>& body, function_tier& tier) {
+		using namespace hexagon;
+		using namespace hexagon::assembly_writer;
+
+		hvm_runtime_guard rt_guard(&hvm_rt);
+		if(!hvm_tier_initialized) {
+			init_runtime_with_vm();
+			hvm_tier_initialized = true;
+		}
+
+		// Only tried once: whatever goes wrong, the function stays interpreted.
+		tier.state = function_tier::states::unsupported;
+		try {
+			StringPoolScope string_pool;
+			function_builder builder;
+			for(auto& arg : args) {
+				builder.add_argument(arg);
+			}
+			builder.map_arg_names();
+			{
+				// Names bound in the body are locals, as they are in the
+				// interpreter, not fields of the global environment.
+				builder_var_scope body_scope(&builder);
+				for(auto& stmt : body) {
+					stmt -> generate_code(builder);
+				}
+			}
+			builder.get_current().Write(BytecodeOp(Opcode::LoadNull));
+			builder.get_current().Write(BytecodeOp(Opcode::Return));
+
+			// Stores to globals would not reach the interpreter storage, nor
+			// stores to arguments the variables they were passed from, and
+			// exceptions have to reach the interpreter as lang_error.
+			if(builder.stores_arguments || builder.uses_exceptions) {
+				return;
+			}
+			global_registry stores;
+			builder.collect_globals(stores);
+			if(!stores.mutable_globals.empty()) {
+				return;
+			}
+
+			tiered_registry *env = new tiered_registry(context);
+			ort::Value env_inst = ort::ObjectProxy(env).Pin(hvm_rt);
+			ort::Function fn = builder.build(hvm_rt, *env, env_inst, hvm_tier_debug, enable_hvm_optimization);
+
+			// Static objects are GC roots, and the function keeps its
+			// environment alive as its `this`.
+			static std::size_t tiered_functions = 0;
+			const std::string key = "cs_tier_" + std::to_string(tiered_functions++);
+			hvm_rt.AttachFunction(key.c_str(), fn);
+			tier.code = hvm_rt.GetStaticObject(key.c_str()).Extract();
+			tier.state = function_tier::states::compiled;
+		} catch(const std::exception&) {
+		}
+	}
+
+	var instance_type::call_tiered(const function_tier& tier, vector& args) {
+		using namespace hexagon;
+
+		hvm_runtime_guard rt_guard(&hvm_rt);
+		std::vector<ort::Value> hvm_args;
+		hvm_args.reserve(args.size());
+		for(auto& arg : args) {
+			hvm_args.push_back(arg.to_hvm_value());
+		}
+		ort::Value ret = hvm_rt.Invoke(ort::Value(tier.code), hvm_args);
+		if(ret.Type() == ort::ValueType::Null) {
+			return null_pointer;
+		}
+		return var::from_hvm_value(ret);
+	}
+
 	void instance_type::init_runtime_with_vm() {
 		using namespace hexagon;
 		using namespace hexagon::assembly_writer;
@@ -179,9 +267,9 @@ namespace cs {
 		ort::Function to_string_fn = FunctionWriter()
 			.Write(
 				BasicBlockWriter()
-					.Write(BytecodeOp("GetArgument", Operand::I64(0)))
-					.Write(BytecodeOp("CastToString"))
-					.Write(BytecodeOp("Return"))
+					.Write(BytecodeOp(Opcode::GetArgument, Operand::I64(0)))
+					.Write(BytecodeOp(Opcode::CastToString))
+					.Write(BytecodeOp(Opcode::Return))
 			)
 			.Build();
 		hvm_rt.AttachFunction("cs_to_string", to_string_fn);
@@ -189,12 +277,57 @@ namespace cs {
 		ort::Function to_integer_fn = FunctionWriter()
 			.Write(
 				BasicBlockWriter()
-					.Write(BytecodeOp("GetArgument", Operand::I64(0)))
-					.Write(BytecodeOp("CastToInt"))
-					.Write(BytecodeOp("Return"))
+					.Write(BytecodeOp(Opcode::GetArgument, Operand::I64(0)))
+					.Write(BytecodeOp(Opcode::CastToInt))
+					.Write(BytecodeOp(Opcode::Return))
 			)
 			.Build();
 		hvm_rt.AttachFunction("cs_to_integer", to_integer_fn);
+
+		// Element access for arrays and hash maps, see function_builder::lower_element_access.
+		ort::Function get_element_fn = ort::Function::LoadNative([this]() {
+			return var::hvm_get_element(hvm_rt.GetArgument(0), hvm_rt.GetArgument(1));
+		});
+		hvm_rt.AttachFunction("cs_get_element", get_element_fn);
+
+		ort::Function set_element_fn = ort::Function::LoadNative([this]() {
+			var::hvm_set_element(hvm_rt.GetArgument(0), hvm_rt.GetArgument(1), hvm_rt.GetArgument(2));
+			return ort::Value::Null();
+		});
+		hvm_rt.AttachFunction("cs_set_element", set_element_fn);
+
+		// Case lookup for switch statements, see statement_switch::generate_code.
+		ort::Function switch_index_fn = ort::Function::LoadNative([this]() {
+			ort::Value key = hvm_rt.GetArgument(1);
+			if(key.Type() == ort::ValueType::Null) {
+				return ort::Value::FromInt(-1);
+			}
+			var table = var::from_hvm_value(hvm_rt.GetArgument(0));
+			// Chars are the values HVM code holds as integers (see
+			// build_value_load and any::to_hvm_value); numbers are floats.
+			var k = key.Type() == ort::ValueType::Int ? var::make<char>(key.ExtractI64()) : var::from_hvm_value(key);
+			return ort::Value::FromInt(table.const_val<switch_table>().find(k));
+		});
+		hvm_rt.AttachFunction("cs_switch_index", switch_index_fn);
+
+		// Exceptions, see statement_throw::generate_code.
+		ort::Function check_exception_fn = ort::Function::LoadNative([this]() {
+			ort::Value e = hvm_rt.GetArgument(0);
+			if(e.Type() != ort::ValueType::Object || var::from_hvm_value(e).type() != typeid(lang_error)) {
+				throw syntax_error("Throwing unsupported exception.");
+			}
+			return e;
+		});
+		hvm_rt.AttachFunction("cs_check_exception", check_exception_fn);
+
+		ort::Function throw_fn = ort::Function::LoadNative([this]() -> ort::Value {
+			var e = var::from_hvm_value(hvm_rt.GetArgument(0));
+			if(e.type() != typeid(lang_error)) {
+				throw syntax_error("Throwing unsupported exception.");
+			}
+			throw e.const_val<lang_error>();
+		});
+		hvm_rt.AttachFunction("cs_throw", throw_fn);
 	}
 
 	void instance_type::init_grammar()
@@ -654,7 +787,7 @@ namespace cs {
 		dvp.expr = right;
 	}
 
-	extension_t instance_type::import(const std::string &path, const std::string &name)
+	static std::string find_package(const std::string &path, const std::string &name)
 	{
 		std::vector<std::string> collection;
 		{
@@ -671,25 +804,215 @@ namespace cs {
 		}
 		for (auto &it:collection) {
 			std::string package_path = it + path_separator + name;
-			if (std::ifstream(package_path + ".csp")) {
-				refers.emplace_front();
-				instance_type &instance = refers.front();
-				instance.compile(package_path + ".csp");
-				instance.interpret();
-				context_t rt = instance.context;
-				if (rt->package_name.empty())
-					throw syntax_error("Target file is not a package.");
-				if (rt->package_name != name)
-					throw syntax_error("Package name is different from file name.");
-				return std::make_shared<extension_holder>(rt->instance->storage.get_global());
-			}
+			if (std::ifstream(package_path + ".csp"))
+				return package_path + ".csp";
 			else if (std::ifstream(package_path + ".cse"))
-				return std::make_shared<extension_holder>(package_path + ".cse");
+				return package_path + ".cse";
 		}
-		throw fatal_error("No such file or directory.");
+		return std::string();
 	}
 
-	void instance_type::compile(const std::string &path)
+	static bool is_script_package(const std::string &file)
+	{
+		return file.size() > 4 && file.compare(file.size() - 4, 4, ".csp") == 0;
+	}
+
+	static std::string canonical_path(const std::string &path)
+	{
+#if defined(__WIN32__) || defined(WIN32)
+		char buff[_MAX_PATH];
+		if (_fullpath(buff, path.c_str(), _MAX_PATH) != nullptr)
+			return buff;
+#else
+		char *buff = realpath(path.c_str(), nullptr);
+		if (buff != nullptr) {
+			std::string str(buff);
+			std::free(buff);
+			return str;
+		}
+#endif
+		return path;
+	}
+
+	static std::time_t modification_time(const std::string &path)
+	{
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			return 0;
+		return info.st_mtime;
+	}
+
+/*
+* Cache of compiled packages, keyed by canonical path. Every importer of an
+* unmodified package shares its statements and its global domain, so the
+* package is compiled and initialized only once. Interpreter state is not
+* thread-safe, so each thread has its own cache and packages are never
+* shared between threads. An entry whose file has changed since it was
+* compiled is dropped on the next lookup.
+*/
+	class package_cache final {
+		struct package_type {
+			std::time_t mtime;
+			std::shared_ptr<instance_type> instance;
+			extension_t extension;
+		};
+		std::unordered_map<std::string, package_type> packages;
+
+		const package_type *find(const std::string &path, std::time_t mtime)
+		{
+			auto it = packages.find(path);
+			if (it == packages.end())
+				return nullptr;
+			if (it->second.mtime != mtime) {
+				packages.erase(it);
+				return nullptr;
+			}
+			return &it->second;
+		}
+
+	public:
+		static package_cache &get()
+		{
+			static thread_local package_cache cache;
+			return cache;
+		}
+
+		bool fetch(const std::string &path, std::time_t mtime, std::shared_ptr<instance_type> &instance,
+		           extension_t &extension)
+		{
+			const package_type *pkg = find(path, mtime);
+			if (pkg == nullptr)
+				return false;
+			instance = pkg->instance;
+			extension = pkg->extension;
+			return true;
+		}
+
+		bool exist(const std::string &path, std::time_t mtime)
+		{
+			return find(path, mtime) != nullptr;
+		}
+
+		void store(const std::string &path, std::time_t mtime, const std::shared_ptr<instance_type> &instance,
+		           const extension_t &extension)
+		{
+			packages[path] = {mtime, instance, extension};
+		}
+	};
+
+	extension_t instance_type::import(const std::string &path, const std::string &name)
+	{
+		std::string file = find_package(path, name);
+		if (file.empty())
+			throw fatal_error("No such file or directory.");
+		if (!is_script_package(file))
+			return std::make_shared<extension_holder>(file);
+		std::string key = canonical_path(file);
+		std::time_t mtime = modification_time(key);
+		std::shared_ptr<instance_type> instance;
+		extension_t extension;
+		if (package_cache::get().fetch(key, mtime, instance, extension)) {
+			refers.push_front(instance);
+			return extension;
+		}
+		std::deque<token_base *> tokens;
+		auto it = prefetched.find(file);
+		if (it != prefetched.end()) {
+			package_prefetch *pkg = it->second;
+			prefetched.erase(it);
+			pkg->ready.get();
+			instance = pkg->instance;
+			std::swap(tokens, pkg->tokens);
+		}
+		else {
+			instance = std::make_shared<instance_type>();
+			instance->lex(file, tokens);
+		}
+		refers.push_front(instance);
+		instance->parse(tokens);
+		instance->interpret();
+		context_t rt = instance->context;
+		if (rt->package_name.empty())
+			throw syntax_error("Target file is not a package.");
+		if (rt->package_name != name)
+			throw syntax_error("Package name is different from file name.");
+		extension = std::make_shared<extension_holder>(rt->instance->storage.get_global());
+		package_cache::get().store(key, mtime, instance, extension);
+		return extension;
+	}
+
+/*
+* Lexes the packages imported by a token stream on worker threads.
+* Only the lexer runs concurrently: it touches nothing but the package's own
+* instance, while the parser folds constants through shared extensions and
+* therefore stays on the importing thread.
+*/
+	class instance_type::package_prefetcher final {
+		instance_type &owner;
+		std::deque<package_prefetch> packages;
+		std::unique_ptr<cov::concurrent_allocation> allocation;
+		std::vector<std::thread> workers;
+		std::atomic<std::size_t> next{0};
+
+		void work()
+		{
+			for (std::size_t i = next++; i < packages.size(); i = next++) {
+				package_prefetch &pkg = packages[i];
+				try {
+					pkg.instance->lex(pkg.path, pkg.tokens);
+					pkg.lexed.set_value();
+				}
+				catch (...) {
+					pkg.lexed.set_exception(std::current_exception());
+				}
+			}
+		}
+
+	public:
+		package_prefetcher(instance_type &instance, const std::deque<token_base *> &tokens) : owner(instance)
+		{
+			for (std::size_t i = 0; i + 2 < tokens.size(); ++i) {
+				token_base *action = tokens[i], *id = tokens[i + 1], *endline = tokens[i + 2];
+				if (action == nullptr || action->get_type() != token_types::action ||
+				        static_cast<token_action *>(action)->get_action() != action_types::import_)
+					continue;
+				if (id == nullptr || id->get_type() != token_types::id || endline == nullptr ||
+				        endline->get_type() != token_types::endline)
+					continue;
+				std::string file = find_package(import_path, static_cast<token_id *>(id)->get_id());
+				if (!is_script_package(file) || owner.prefetched.count(file) > 0)
+					continue;
+				std::string key = canonical_path(file);
+				if (package_cache::get().exist(key, modification_time(key)))
+					continue;
+				packages.emplace_back();
+				package_prefetch &pkg = packages.back();
+				pkg.instance = std::make_shared<instance_type>();
+				pkg.path = file;
+				pkg.ready = pkg.lexed.get_future();
+				owner.prefetched.emplace(file, &pkg);
+			}
+			if (packages.empty())
+				return;
+			std::size_t concurrency = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+			allocation.reset(new cov::concurrent_allocation);
+			for (std::size_t i = 0; i < std::min(concurrency, packages.size()); ++i)
+				workers.emplace_back(&package_prefetcher::work, this);
+		}
+
+		package_prefetcher(const package_prefetcher &) = delete;
+
+		~package_prefetcher()
+		{
+			for (auto &worker:workers)
+				worker.join();
+			allocation.reset();
+			for (auto &pkg:packages)
+				owner.prefetched.erase(pkg.path);
+		}
+	};
+
+	void instance_type::lex(const std::string &path, std::deque<token_base *> &tokens)
 	{
 		context->file_path = path;
 		// Read from file
@@ -700,14 +1023,61 @@ namespace cs {
 		for (int ch = in.get(); ch != EOF; ch = in.get())
 			buff.push_back(ch);
 		// Lexer
-		std::deque<token_base *> tokens;
 		translate_into_tokens(buff, tokens);
+	}
+
+	void instance_type::parse(std::deque<token_base *> &tokens)
+	{
+		// Lex the imported packages while this file is being parsed
+		package_prefetcher prefetcher(*this, tokens);
 		// Parser
 		translate_into_statements(tokens, statements);
 		// Mark Constants
 		mark_constant();
 	}
 
+	void instance_type::compile(const std::string &path)
+	{
+		std::deque<token_base *> tokens;
+		lex(path, tokens);
+		parse(tokens);
+	}
+
+	void instance_type::compile_string(const std::string &code, const std::string &path)
+	{
+		context->file_path = path;
+		std::deque<char> buff(code.begin(), code.end());
+		std::deque<token_base *> tokens;
+		translate_into_tokens(buff, tokens);
+		parse(tokens);
+	}
+
+	var instance_type::invoke(const std::string &name, vector &args)
+	{
+		if (!storage.var_exist_global(name))
+			throw fatal_error("Use of undefined function \"" + name + "\".");
+		const var &func = storage.get_var_global(name);
+		if (func.type() != typeid(callable))
+			throw fatal_error("\"" + name + "\" is not a function.");
+		try {
+			return func.const_val<callable>().call(args);
+		}
+		catch (const lang_error &le) {
+			throw fatal_error(std::string("Uncaught exception: ") + le.what());
+		}
+	}
+
+	void instance_type::reset()
+	{
+		// Discard whatever an aborted invocation left behind
+		return_fcall = false;
+		break_block = false;
+		continue_block = false;
+		while (!fcall_stack.empty())
+			fcall_stack.pop();
+		storage.clear_local_domains();
+	}
+
 	void instance_type::interpret()
 	{
 		// Run the instruction
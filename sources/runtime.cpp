@@ -53,6 +53,13 @@ namespace cs {
 
 	var runtime_type::parse_addasi(var a, const var &b)
 	{
+		// The swap below replaces the data for everyone sharing this var
+		// anyway (by-reference arguments, hash_map keys), so appending to the
+		// string in place is observably the same, without the copy.
+		if (a.type() == typeid(string) && !a.is_protect()) {
+			a.val<string>(true).append(b.to_string());
+			return a;
+		}
 		a.swap(parse_add(a, b), true);
 		return a;
 	}
@@ -344,6 +351,24 @@ namespace cs {
 	var runtime_type::parse_fcall(const var &a, token_base *b)
 	{
 		if (a.type() == typeid(callable)) {
+			// Calls to small side-effect-free functions evaluate the body
+			// expression with the arguments in place, without a call frame.
+			// The body reads names through this instance, so functions from
+			// another one (an imported package) are called as usual.
+			const function *func = a.const_val<callable>().get_function();
+			if (func != nullptr && !a.const_val<callable>().is_member_fn() &&
+			        func->get_context()->instance == this) {
+				const cov::tree<token_base *> *body = func->get_inline_body();
+				if (body != nullptr) {
+					token_arglist *arglist = static_cast<token_arglist *>(b);
+					if (arglist->inline_source != body) {
+						arglist->inline_expr = func->inline_call(arglist->get_arglist());
+						arglist->inline_source = body;
+					}
+					if (!arglist->inline_expr.empty())
+						return parse_expr(arglist->inline_expr.root());
+				}
+			}
 			vector args;
 			args.reserve(static_cast<token_arglist *>(b)->get_arglist().size());
 			for (auto &tree:static_cast<token_arglist *>(b)->get_arglist())
@@ -362,6 +387,14 @@ namespace cs {
 			throw syntax_error("Unsupported operator operations(Fcall).");
 	}
 
+	// Entry that map[key] inserts for a missing key.
+	struct access_default final {
+		hash_map::value_type operator()(const var &key) const
+		{
+			return hash_map::value_type(copy(key), number(0));
+		}
+	};
+
 	var runtime_type::parse_access(var a, const var &b)
 	{
 		if (a.type() == typeid(array)) {
@@ -379,10 +412,30 @@ namespace cs {
 			return carr.at(posit);
 		}
 		else if (a.type() == typeid(hash_map)) {
-			const hash_map &cmap = a.const_val<hash_map>();
-			if (cmap.count(b) == 0)
-				a.val<hash_map>(true).emplace(copy(b), number(0));
-			return cmap.at(b);
+			if (a.is_constant()) {
+				const hash_map &cmap = a.const_val<hash_map>();
+				auto it = cmap.find(b);
+				if (it != cmap.end())
+					return it->second;
+			}
+			// One probe finds the element or the slot to insert it into,
+			// so the key is hashed once and only copied when it is new.
+			return a.val<hash_map>(true).find_or_insert<access_default>(b).second;
+		}
+		else if (a.type() == typeid(string_map)) {
+			if (b.type() != typeid(string))
+				throw syntax_error("Key of string_map must be a string.");
+			const string &key = b.const_val<string>();
+			if (a.is_constant()) {
+				const string_map &cmap = a.const_val<string_map>();
+				auto it = cmap.find(key);
+				if (it != cmap.end())
+					return it->second;
+			}
+			auto result = a.val<string_map>(true).emplace(key, var());
+			if (result.second)
+				result.first->second = number(0);
+			return result.first->second;
 		}
 		else if (a.type() == typeid(string)) {
 			if (b.type() != typeid(number))
@@ -399,16 +452,16 @@ namespace cs {
 
 		if(v.type() == typeid(int) || v.type() == typeid(long) || v.type() == typeid(long long) || v.type() == typeid(char)) {
 			auto inner = v.to_integer();
-			builder.get_current().Write(BytecodeOp("LoadInt", Operand::I64(inner)));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadInt, Operand::I64(inner)));
 		} else if(v.type() == typeid(float)) {
-			builder.get_current().Write(BytecodeOp("LoadFloat", Operand::F64(v.const_val<float>())));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadFloat, Operand::F64(v.const_val<float>())));
 		} else if(v.type() == typeid(double)) {
-			builder.get_current().Write(BytecodeOp("LoadFloat", Operand::F64(v.const_val<double>())));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadFloat, Operand::F64(v.const_val<double>())));
 		} else if(v.type() == typeid(long double)) {
-			builder.get_current().Write(BytecodeOp("LoadFloat", Operand::F64(v.const_val<long double>())));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadFloat, Operand::F64(v.const_val<long double>())));
 		} else if(v.type() == typeid(string)) {
 			auto inner = v.to_string();
-			builder.get_current().Write(BytecodeOp("LoadString", Operand::String(inner)));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String(inner)));
 		} else if(v.type() == typeid(array)) {
 			array arr;
 			for (const var& elem : v.const_val<array>()) {
@@ -417,17 +470,17 @@ namespace cs {
 			std::string v_id = cs_impl::unique_id::random_string(16);
 
 			builder.external_vars.insert(std::make_pair(v_id, var::make<array>(std::move(arr))));
-			builder.get_current().Write(BytecodeOp("LoadString", Operand::String(v_id)));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String(v_id)));
 			builder.write_get_from_global_registry();
 		} else if(v.type() == typeid(pointer)) {
 			pointer p = v.const_val<pointer>();
 			if(p.data.usable()) {
 				throw syntax_error("Only null pointers are supported");
 			}
-			builder.get_current().Write(BytecodeOp("LoadNull"));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadNull));
 		} else if(v.type() == typeid(cs::boolean)) {
 			bool b = v.const_val<cs::boolean>();
-			builder.get_current().Write(BytecodeOp("LoadBool", Operand::Bool(b)));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadBool, Operand::Bool(b)));
 		} else if(v.type() == typeid(cs::callable)) {
 			const cs::callable& callable = v.const_val<cs::callable>();
 			throw internal_error("callable");
@@ -436,6 +489,71 @@ namespace cs {
 		}
 	}
 
+	// Names other than the parameters in an inline body must be globals
+	// at the call site too, as they are in the function.
+	static bool refers_to_globals(const cov::tree<token_base *>::const_iterator &it, const std::vector<std::string> &params, function_builder& builder) {
+		if(!it.usable() || it.data() == nullptr) {
+			return true;
+		}
+		if(it.data()->get_type() == token_types::id) {
+			const std::string& id = static_cast<token_id *>(it.data())->get_id();
+			int local_id = -1;
+			return std::find(params.begin(), params.end(), id) != params.end() || !builder.try_map_local(id, local_id);
+		}
+		return refers_to_globals(it.left(), params, builder) && refers_to_globals(it.right(), params, builder);
+	}
+
+	// A call to a function defined in the entry function whose body is one
+	// side-effect-free return statement (see function::get_inline_body) is
+	// replaced by the body expression. The arguments are stored in new locals
+	// in order first, as a call would, so they may have side effects. Returns
+	// false if the call has to be compiled as usual.
+	bool runtime_type::generate_inline_call(const cov::tree<token_base *>::iterator &it, function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		token_base *callee = it.left().data();
+		// Methods reach globals through the object they are called on.
+		if(callee == nullptr || callee -> get_type() != token_types::id || !builder.bind_this) {
+			return false;
+		}
+		const std::string& name = static_cast<token_id *>(callee)->get_id();
+		auto& inline_functions = builder.root().inline_functions;
+		auto entry = inline_functions.find(name);
+		if(entry == inline_functions.end() || entry -> second.first == nullptr) {
+			return false;
+		}
+
+		// The name has to refer to the function: the local it is stored in
+		// within the entry function, or the registry entry elsewhere.
+		int local_id = -1;
+		bool is_local = builder.try_map_local(name, local_id);
+		if(builder.parent == nullptr ? (!is_local || local_id != entry -> second.second) : is_local) {
+			return false;
+		}
+
+		const function& func = *entry -> second.first;
+		const cov::tree<token_base *> *body = func.get_inline_body();
+		auto& args = static_cast<token_arglist *>(it.right().data())->get_arglist();
+		if(body == nullptr || args.size() != func.mArgs.size() || !refers_to_globals(body -> root(), func.mArgs, builder)) {
+			return false;
+		}
+
+		for(auto& tree : args) {
+			generate_code_from_expr(tree.root(), builder);
+		}
+		builder_var_scope var_scope(&builder);
+		std::vector<int> params;
+		for(auto& param : func.mArgs) {
+			params.push_back(builder.map_new_local(param));
+		}
+		for(auto param = params.rbegin(); param != params.rend(); ++param) {
+			builder.get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(*param)));
+		}
+		cov::tree<token_base *> expr(*body);
+		generate_code_from_expr(expr.root(), builder);
+		return true;
+	}
+
 	// This should push **exactly** one value onto the stack.
 	void runtime_type::generate_code_from_expr(const cov::tree<token_base *>::iterator &it, function_builder& builder) {
 		using namespace hexagon::assembly_writer;
@@ -444,7 +562,7 @@ namespace cs {
 			throw internal_error("The expression tree is not available.");
 		token_base *token = it.data();
 		if (token == nullptr) {
-			builder.get_current().Write(BytecodeOp("LoadNull"));
+			builder.get_current().Write(BytecodeOp(Opcode::LoadNull));
 			return;
 		}
 
@@ -455,13 +573,15 @@ namespace cs {
 				static_cast<token_id *>(token)->get_id(),
 				local_id
 			);
-			if(!found) {
+			if(!found && static_cast<token_id *>(token)->get_id() == "this") {
+				builder.get_current().Write(BytecodeOp(Opcode::LoadThis));
+			} else if(!found) {
 				builder.get_current()
-					.Write(BytecodeOp("LoadString", Operand::String(static_cast<token_id *>(token)->get_id())))
-					.Write(BytecodeOp("LoadThis"))
-					.Write(BytecodeOp("GetField"));
+					.Write(BytecodeOp(Opcode::LoadString, Operand::String(static_cast<token_id *>(token)->get_id())))
+					.Write(BytecodeOp(Opcode::LoadThis))
+					.Write(BytecodeOp(Opcode::GetField));
 			} else {
-				builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(local_id)));
+				builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(local_id)));
 			}
 			return;
 		}
@@ -472,25 +592,26 @@ namespace cs {
 			generate_code_from_expr(static_cast<token_expr *>(token)->get_tree().root(), builder);
 			return;
 		case token_types::array:
+			builder.check_throw_free();
 			builder.get_current()
-				.Write(BytecodeOp("LoadString", Operand::String("__new__")))
-				.Write(BytecodeOp("LoadNull"))
-				.Write(BytecodeOp("LoadString", Operand::String("array")))
-				.Write(BytecodeOp("LoadThis"))
-				.Write(BytecodeOp("GetField"))
-				.Write(BytecodeOp("CallField", Operand::I64(0)));
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String("__new__")))
+				.Write(BytecodeOp(Opcode::LoadNull))
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String("array")))
+				.Write(BytecodeOp(Opcode::LoadThis))
+				.Write(BytecodeOp(Opcode::GetField))
+				.Write(BytecodeOp(Opcode::CallField, Operand::I64(0)));
 
 			for (auto &tree:static_cast<token_array *>(token)->get_array()) {
-				builder.get_current().Write(BytecodeOp("Dup"));
+				builder.get_current().Write(BytecodeOp(Opcode::Dup));
 				generate_code_from_expr(tree.root(), builder);
 				builder.get_current()
-					.Write(BytecodeOp("Rotate2"))
-					.Write(BytecodeOp("LoadString", Operand::String("push_back")))
-					.Write(BytecodeOp("Rotate2"))
-					.Write(BytecodeOp("LoadNull"))
-					.Write(BytecodeOp("Rotate2"))
-					.Write(BytecodeOp("CallField", Operand::I64(1)))
-					.Write(BytecodeOp("Pop"));
+					.Write(BytecodeOp(Opcode::Rotate2))
+					.Write(BytecodeOp(Opcode::LoadString, Operand::String("push_back")))
+					.Write(BytecodeOp(Opcode::Rotate2))
+					.Write(BytecodeOp(Opcode::LoadNull))
+					.Write(BytecodeOp(Opcode::Rotate2))
+					.Write(BytecodeOp(Opcode::CallField, Operand::I64(1)))
+					.Write(BytecodeOp(Opcode::Pop));
 			}
 			return;
 		case token_types::signal:
@@ -498,14 +619,14 @@ namespace cs {
 				case signal_types::add_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Add"));
+					builder.get_current().Write(BytecodeOp(Opcode::Add));
 					break;
 				}
 				case signal_types::addasi_: {
 					int rvalue_id = builder.anonymous_local();
 					generate_code_from_expr(it.right(), builder);
 					builder.get_current()
-						.Write(BytecodeOp("SetLocal", Operand::I64(rvalue_id)));
+						.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(rvalue_id)));
 
 					generate_code_from_expr(it.left(), builder);
 
@@ -513,26 +634,26 @@ namespace cs {
 
 					builder.transform_last_op_to_modify([&]() {
 						builder.get_current()
-							.Write(BytecodeOp("GetLocal", Operand::I64(rvalue_id)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("Add"))
-							.Write(BytecodeOp("Dup"))
-							.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+							.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(rvalue_id)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::Add))
+							.Write(BytecodeOp(Opcode::Dup))
+							.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::sub_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Sub"));
+					builder.get_current().Write(BytecodeOp(Opcode::Sub));
 					break;
 				}
 				case signal_types::subasi_: {
 					int rvalue_id = builder.anonymous_local();
 					generate_code_from_expr(it.right(), builder);
 					builder.get_current()
-						.Write(BytecodeOp("SetLocal", Operand::I64(rvalue_id)));
+						.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(rvalue_id)));
 
 					generate_code_from_expr(it.left(), builder);
 
@@ -540,26 +661,26 @@ namespace cs {
 
 					builder.transform_last_op_to_modify([&]() {
 						builder.get_current()
-							.Write(BytecodeOp("GetLocal", Operand::I64(rvalue_id)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("Sub"))
-							.Write(BytecodeOp("Dup"))
-							.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+							.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(rvalue_id)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::Sub))
+							.Write(BytecodeOp(Opcode::Dup))
+							.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::mul_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Mul"));
+					builder.get_current().Write(BytecodeOp(Opcode::Mul));
 					break;
 				}
 				case signal_types::mulasi_: {
 					int rvalue_id = builder.anonymous_local();
 					generate_code_from_expr(it.right(), builder);
 					builder.get_current()
-						.Write(BytecodeOp("SetLocal", Operand::I64(rvalue_id)));
+						.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(rvalue_id)));
 
 					generate_code_from_expr(it.left(), builder);
 
@@ -567,26 +688,26 @@ namespace cs {
 
 					builder.transform_last_op_to_modify([&]() {
 						builder.get_current()
-							.Write(BytecodeOp("GetLocal", Operand::I64(rvalue_id)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("Mul"))
-							.Write(BytecodeOp("Dup"))
-							.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+							.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(rvalue_id)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::Mul))
+							.Write(BytecodeOp(Opcode::Dup))
+							.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::div_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Div"));
+					builder.get_current().Write(BytecodeOp(Opcode::Div));
 					break;
 				}
 				case signal_types::divasi_: {
 					int rvalue_id = builder.anonymous_local();
 					generate_code_from_expr(it.right(), builder);
 					builder.get_current()
-						.Write(BytecodeOp("SetLocal", Operand::I64(rvalue_id)));
+						.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(rvalue_id)));
 
 					generate_code_from_expr(it.left(), builder);
 
@@ -594,26 +715,26 @@ namespace cs {
 
 					builder.transform_last_op_to_modify([&]() {
 						builder.get_current()
-							.Write(BytecodeOp("GetLocal", Operand::I64(rvalue_id)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("Div"))
-							.Write(BytecodeOp("Dup"))
-							.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+							.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(rvalue_id)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::Div))
+							.Write(BytecodeOp(Opcode::Dup))
+							.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::mod_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Mod"));
+					builder.get_current().Write(BytecodeOp(Opcode::Mod));
 					break;
 				}
 				case signal_types::modasi_: {
 					int rvalue_id = builder.anonymous_local();
 					generate_code_from_expr(it.right(), builder);
 					builder.get_current()
-						.Write(BytecodeOp("SetLocal", Operand::I64(rvalue_id)));
+						.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(rvalue_id)));
 
 					generate_code_from_expr(it.left(), builder);
 
@@ -621,26 +742,26 @@ namespace cs {
 
 					builder.transform_last_op_to_modify([&]() {
 						builder.get_current()
-							.Write(BytecodeOp("GetLocal", Operand::I64(rvalue_id)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("Mod"))
-							.Write(BytecodeOp("Dup"))
-							.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+							.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(rvalue_id)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::Mod))
+							.Write(BytecodeOp(Opcode::Dup))
+							.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::pow_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Pow"));
+					builder.get_current().Write(BytecodeOp(Opcode::Pow));
 					break;
 				}
 				case signal_types::powasi_: {
 					int rvalue_id = builder.anonymous_local();
 					generate_code_from_expr(it.right(), builder);
 					builder.get_current()
-						.Write(BytecodeOp("SetLocal", Operand::I64(rvalue_id)));
+						.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(rvalue_id)));
 
 					generate_code_from_expr(it.left(), builder);
 
@@ -648,19 +769,19 @@ namespace cs {
 
 					builder.transform_last_op_to_modify([&]() {
 						builder.get_current()
-							.Write(BytecodeOp("GetLocal", Operand::I64(rvalue_id)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("Pow"))
-							.Write(BytecodeOp("Dup"))
-							.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+							.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(rvalue_id)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::Pow))
+							.Write(BytecodeOp(Opcode::Dup))
+							.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::minus_: {
 					generate_code_from_expr(it.right(), builder);
-					builder.get_current().Write(BytecodeOp("LoadInt", Operand::I64(0)));
-					builder.get_current().Write(BytecodeOp("Sub"));
+					builder.get_current().Write(BytecodeOp(Opcode::LoadInt, Operand::I64(0)));
+					builder.get_current().Write(BytecodeOp(Opcode::Sub));
 					break;
 				}
 				case signal_types::inc_: {
@@ -684,23 +805,23 @@ namespace cs {
 					builder.transform_last_op_to_modify([&]() {
 						if(!is_right) {
 							builder.get_current()
-								.Write(BytecodeOp("Dup"))
-								.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+								.Write(BytecodeOp(Opcode::Dup))
+								.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 						}
 
 						builder.get_current()
-							.Write(BytecodeOp("LoadInt", Operand::I64(1)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("IntAdd"));
+							.Write(BytecodeOp(Opcode::LoadInt, Operand::I64(1)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::IntAdd));
 							
 
 						if(is_right) {
 							builder.get_current()
-								.Write(BytecodeOp("Dup"))
-								.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+								.Write(BytecodeOp(Opcode::Dup))
+								.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 						}
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::dec_: {
@@ -724,28 +845,28 @@ namespace cs {
 					builder.transform_last_op_to_modify([&]() {
 						if(!is_right) {
 							builder.get_current()
-								.Write(BytecodeOp("Dup"))
-								.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+								.Write(BytecodeOp(Opcode::Dup))
+								.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 						}
 
 						builder.get_current()
-							.Write(BytecodeOp("LoadInt", Operand::I64(1)))
-							.Write(BytecodeOp("Rotate2"))
-							.Write(BytecodeOp("IntSub"));
+							.Write(BytecodeOp(Opcode::LoadInt, Operand::I64(1)))
+							.Write(BytecodeOp(Opcode::Rotate2))
+							.Write(BytecodeOp(Opcode::IntSub));
 							
 
 						if(is_right) {
 							builder.get_current()
-								.Write(BytecodeOp("Dup"))
-								.Write(BytecodeOp("SetLocal", Operand::I64(result_id)));
+								.Write(BytecodeOp(Opcode::Dup))
+								.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(result_id)));
 						}
 					});
-					builder.get_current().Write(BytecodeOp("GetLocal", Operand::I64(result_id)));
+					builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(result_id)));
 					break;
 				}
 				case signal_types::asi_: {
 					generate_code_from_expr(it.right(), builder);
-					builder.get_current().Write(BytecodeOp("Dup"));
+					builder.get_current().Write(BytecodeOp(Opcode::Dup));
 
 					generate_code_from_expr(it.left(), builder);
 					builder.transform_last_op_to_set();
@@ -754,75 +875,82 @@ namespace cs {
 				case signal_types::und_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("TestLt"));
+					builder.get_current().Write(BytecodeOp(Opcode::TestLt));
 					break;
 				}
 				case signal_types::abo_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("TestGt"));
+					builder.get_current().Write(BytecodeOp(Opcode::TestGt));
 					break;
 				}
 				case signal_types::ueq_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("TestLe"));
+					builder.get_current().Write(BytecodeOp(Opcode::TestLe));
 					break;
 				}
 				case signal_types::aeq_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("TestGe"));
+					builder.get_current().Write(BytecodeOp(Opcode::TestGe));
 					break;
 				}
 				case signal_types::neq_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("TestNe"));
+					builder.get_current().Write(BytecodeOp(Opcode::TestNe));
 					break;
 				}
 				case signal_types::equ_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("TestEq"));
+					builder.get_current().Write(BytecodeOp(Opcode::TestEq));
 					break;
 				}
 				case signal_types::and_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("And"));
+					builder.get_current().Write(BytecodeOp(Opcode::And));
 					break;
 				}
 				case signal_types::or_: {
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Or"));
+					builder.get_current().Write(BytecodeOp(Opcode::Or));
 					break;
 				}
 				case signal_types::not_: {
-					generate_code_from_expr(it.left(), builder);
-					builder.get_current().Write(BytecodeOp("Not"));
+					generate_code_from_expr(it.right(), builder);
+					builder.get_current().Write(BytecodeOp(Opcode::Not));
 					break;
 				}
 				case signal_types::access_: {
+					builder.check_throw_free();
 					generate_code_from_expr(it.right(), builder);
 					generate_code_from_expr(it.left(), builder);
 
-					builder.get_current().Write(BytecodeOp("GetArrayElement"));
+					builder.get_current().Write(BytecodeOp(Opcode::GetArrayElement));
 					break;
 				}
 				case signal_types::dot_: {
+					builder.check_throw_free();
 					token_base *right_data = it.right().data();
 					std::string field_name = static_cast<token_id *>(right_data)->get_id();
-					builder.get_current().Write(BytecodeOp("LoadString", Operand::String(field_name)));
+					builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String(field_name)));
 
 					generate_code_from_expr(it.left(), builder);
 
-					builder.get_current().Write(BytecodeOp("GetField"));
+					builder.get_current().Write(BytecodeOp(Opcode::GetField));
 
 					break;
 				}
 				case signal_types::fcall_: {
+					if(generate_inline_call(it, builder)) {
+						break;
+					}
+					builder.check_throw_free();
+
 					token_base *args = it.right().data();
 					int n_args = static_cast<token_arglist *>(args)->get_arglist().size();
 					
@@ -830,7 +958,7 @@ namespace cs {
 						generate_code_from_expr(tree.root(), builder);
 					}
 					if(n_args) {
-						builder.get_current().Write(BytecodeOp("RotateReverse", Operand::I64(n_args)));
+						builder.get_current().Write(BytecodeOp(Opcode::RotateReverse, Operand::I64(n_args)));
 					}
 
 					generate_code_from_expr(it.left(), builder);
@@ -864,21 +992,24 @@ namespace cs {
 						lambda_builder.map_arg_names();
 
 						generate_code_from_expr(it.right(), lambda_builder);
-						lambda_builder.get_current().Write(BytecodeOp("Return"));
+						lambda_builder.get_current().Write(BytecodeOp(Opcode::Return));
 					}
 
-					builder.get_current().Write(BytecodeOp("LoadString", Operand::String(lambda_name)));
+					builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String(lambda_name)));
 					builder.write_get_from_global_registry();
 
 					break;
 				}
 				case signal_types::new_: {
-					builder.get_current()
-						.Write(BytecodeOp("LoadString", Operand::String("__new__")))
-						.Write(BytecodeOp("LoadNull"));
+					// The type is passed as `this`, which the constructors of
+					// compiled structs use as the prototype of the new object.
+					builder.check_throw_free();
+					builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String("__new__")));
 
 					generate_code_from_expr(it.right(), builder);
-					builder.get_current().Write(BytecodeOp("CallField", Operand::I64(0)));
+					builder.get_current()
+						.Write(BytecodeOp(Opcode::Dup))
+						.Write(BytecodeOp(Opcode::CallField, Operand::I64(0)));
 
 					break;
 				}
@@ -22,17 +22,199 @@
 #include "covscript.cpp"
 #include <hexagon/ort.h>
 
+#if !defined(__WIN32__) && !defined(WIN32)
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <set>
+
+#endif
+
 std::string log_path;
 bool compile_only = false;
 bool wait_before_exit = false;
 bool enable_hvm = false;
 bool hvm_debug = false;
 bool hvm_optimize = false;
+bool hvm_tiered = false;
+std::string worker_entry;
+std::string worker_socket;
+std::size_t worker_count = 1;
+
+// Worker mode: every line is a job, passed to the entry function as a string and answered
+// on a line of its own by "+result" or "-error", with backslashes and newlines escaped.
+std::string worker_escape(const std::string &str)
+{
+	std::string escaped;
+	for (auto &ch:str) {
+		switch (ch) {
+		case '\\':
+			escaped += "\\\\";
+			break;
+		case '\n':
+			escaped += "\\n";
+			break;
+		default:
+			escaped.push_back(ch);
+		}
+	}
+	return escaped;
+}
+
+std::string worker_process(cs::instance_type &instance, std::string job)
+{
+	if (!job.empty() && job.back() == '\r')
+		job.pop_back();
+	try {
+		cs::vector args{cs::var::make<cs::string>(job)};
+		return "+" + worker_escape(instance.invoke(worker_entry, args).to_string());
+	}
+	catch (const std::exception &e) {
+		instance.reset();
+		return "-" + worker_escape(e.what());
+	}
+}
+
+#if !defined(__WIN32__) && !defined(WIN32)
+
+void worker_serve(int fd, cs::instance_type &instance)
+{
+	std::string buff;
+	char chunk[4096];
+	for (ssize_t size = ::read(fd, chunk, sizeof(chunk)); size != 0; size = ::read(fd, chunk, sizeof(chunk))) {
+		if (size < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		buff.append(chunk, size);
+		for (std::size_t pos = buff.find('\n'); pos != std::string::npos; pos = buff.find('\n')) {
+			std::string reply = worker_process(instance, buff.substr(0, pos)) + "\n";
+			buff.erase(0, pos + 1);
+			for (std::size_t sent = 0; sent < reply.size();) {
+				ssize_t count = ::write(fd, reply.data() + sent, reply.size() - sent);
+				if (count < 0 && errno != EINTR)
+					return;
+				if (count > 0)
+					sent += count;
+			}
+		}
+	}
+}
+
+pid_t worker_fork(int server, cs::instance_type &instance)
+{
+	pid_t pid = ::fork();
+	if (pid < 0)
+		throw cs::fatal_error("failed to fork worker process.");
+	if (pid == 0) {
+		while (true) {
+			int client = ::accept(server, nullptr, nullptr);
+			if (client < 0) {
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				// Leave without running the parent's exit handlers and destructors
+				::_exit(-1);
+			}
+			worker_serve(client, instance);
+			::close(client);
+		}
+	}
+	return pid;
+}
+
+void worker_listen(cs::instance_type &instance)
+{
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (worker_socket.size() >= sizeof(addr.sun_path))
+		throw cs::fatal_error("worker socket path is too long.");
+	std::strcpy(addr.sun_path, worker_socket.c_str());
+	int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0)
+		throw cs::fatal_error("failed to create worker socket.");
+	::unlink(worker_socket.c_str());
+	if (::bind(server, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(server, SOMAXCONN) != 0)
+		throw cs::fatal_error("failed to listen on " + worker_socket + ".");
+	std::signal(SIGPIPE, SIG_IGN);
+	std::cout.flush();
+	std::cerr.flush();
+	std::set<pid_t> workers;
+	for (std::size_t i = 0; i < worker_count; ++i)
+		workers.insert(worker_fork(server, instance));
+	// Replace the workers that crashed, stop when all of them exited normally.
+	// Every crash shortly after the previous one delays the next respawn a little
+	// longer, and too many of them in a row mean the workers cannot run at all.
+	const std::size_t max_crashes = 5;
+	const auto crash_interval = std::chrono::seconds(10);
+	std::size_t crashes = 0;
+	auto last_crash = std::chrono::steady_clock::now();
+	while (!workers.empty()) {
+		int status = 0;
+		pid_t pid = ::waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		workers.erase(pid);
+		if (!WIFSIGNALED(status))
+			continue;
+		auto now = std::chrono::steady_clock::now();
+		crashes = now - last_crash < crash_interval ? crashes + 1 : 1;
+		last_crash = now;
+		if (crashes > max_crashes) {
+			for (auto &worker:workers)
+				::kill(worker, SIGTERM);
+			for (auto &worker:workers)
+				::waitpid(worker, nullptr, 0);
+			::close(server);
+			throw cs::fatal_error("worker crashed " + std::to_string(crashes) + " times in a row, giving up.");
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100) * (1 << (crashes - 1)));
+		workers.insert(worker_fork(server, instance));
+	}
+	::close(server);
+}
+
+#endif
+
+void worker_main(cs::instance_type &instance)
+{
+	if (enable_hvm)
+		throw cs::fatal_error("worker mode does not support hvm.");
+	instance.interpret();
+	if (!instance.storage.var_exist_global(worker_entry))
+		throw cs::fatal_error("worker entry \"" + worker_entry + "\" is not defined.");
+	if (instance.storage.get_var_global(worker_entry).type() != typeid(cs::callable))
+		throw cs::fatal_error("worker entry \"" + worker_entry + "\" is not a function.");
+	if (worker_socket.empty()) {
+		for (std::string line; std::getline(std::cin, line);)
+			std::cout << worker_process(instance, line) << std::endl;
+	}
+	else {
+#if defined(__WIN32__) || defined(WIN32)
+		throw cs::fatal_error("worker socket is not supported on this platform.");
+#else
+		worker_listen(instance);
+#endif
+	}
+}
 
 int covscript_args(int args_size, const char *args[])
 {
 	int expect_log_path = 0;
 	int expect_import_path = 0;
+	int expect_worker_entry = 0;
+	int expect_worker_socket = 0;
+	int expect_worker_count = 0;
 	int index = 1;
 	for (; index < args_size; ++index) {
 		if (expect_log_path == 1) {
@@ -43,6 +225,22 @@ int covscript_args(int args_size, const char *args[])
 			cs::import_path += cs::path_delimiter + process_path(args[index]);
 			expect_import_path = 2;
 		}
+		else if (expect_worker_entry == 1) {
+			worker_entry = args[index];
+			expect_worker_entry = 2;
+		}
+		else if (expect_worker_socket == 1) {
+			worker_socket = process_path(args[index]);
+			expect_worker_socket = 2;
+		}
+		else if (expect_worker_count == 1) {
+			char *end = nullptr;
+			long count = std::strtol(args[index], &end, 10);
+			if (*end != '\0' || count <= 0)
+				throw cs::fatal_error("argument syntax error.");
+			worker_count = count;
+			expect_worker_count = 2;
+		}
 		else if (args[index][0] == '-') {
 			if (std::strcmp(args[index], "--compile-only") == 0 && !compile_only)
 				compile_only = true;
@@ -58,13 +256,22 @@ int covscript_args(int args_size, const char *args[])
 				hvm_debug = true;
 			else if (std::strcmp(args[index], "--hvm-optimize") == 0 && !hvm_optimize)
 				hvm_optimize = true;
+			else if (std::strcmp(args[index], "--hvm-tiered") == 0 && !hvm_tiered)
+				hvm_tiered = true;
+			else if (std::strcmp(args[index], "--worker") == 0 && expect_worker_entry == 0)
+				expect_worker_entry = 1;
+			else if (std::strcmp(args[index], "--worker-socket") == 0 && expect_worker_socket == 0)
+				expect_worker_socket = 1;
+			else if (std::strcmp(args[index], "--worker-count") == 0 && expect_worker_count == 0)
+				expect_worker_count = 1;
 			else
 				throw cs::fatal_error("argument syntax error.");
 		}
 		else
 			break;
 	}
-	if (expect_log_path == 1 || expect_import_path == 1)
+	if (expect_log_path == 1 || expect_import_path == 1 || expect_worker_entry == 1 || expect_worker_socket == 1 ||
+	        expect_worker_count == 1)
 		throw cs::fatal_error("argument syntax error.");
 	return index;
 }
@@ -84,9 +291,15 @@ void covscript_main(int args_size, const char *args[])
 		cs::init_ext();
 		cs::instance_type instance(enable_hvm);
 		instance.enable_hvm_optimization = hvm_optimize;
+		instance.enable_hvm_tiering = hvm_tiered;
 
 		instance.compile(path);
 
+		if (!worker_entry.empty() && !compile_only) {
+			worker_main(instance);
+			return;
+		}
+
 		if(hvm_debug) {
 			hexagon::EnableDebug();
 		}
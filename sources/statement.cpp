@@ -20,6 +20,9 @@
 */
 #include <covscript/statement.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <hexagon/ort_assembly_writer.h>
 
 namespace cs {
@@ -28,6 +31,13 @@ namespace cs {
 		if (args.size() != this->mArgs.size())
 			throw syntax_error("Wrong size of arguments.Expected " + std::to_string(this->mArgs.size()) + ",provided " +
 			                   std::to_string(args.size()));
+		if (mContext->instance->enable_hvm_tiering && mTier->state != function_tier::states::unsupported) {
+			if (mTier->state == function_tier::states::interpreted && ++mTier->hotness >= mContext->instance->hvm_tier_threshold)
+				mContext->instance->tier_up(mArgs, mBody, *mTier);
+			if (mTier->state == function_tier::states::compiled)
+				return mContext->instance->call_tiered(*mTier, args);
+		}
+		back_edge_guard back_edges(mContext, *mTier);
 		scope_guard scope(mContext);
 		fcall_guard fcall(mContext);
 		for (std::size_t i = 0; i < args.size(); ++i)
@@ -53,6 +63,115 @@ namespace cs {
 		return fcall.get();
 	}
 
+	// Expressions that may take the place of a call: reads of variables and
+	// constants combined by arithmetic, comparison and logic operators. They
+	// have no effect besides their value, so where and how often they are
+	// evaluated does not matter.
+	static bool is_inlinable_expr(const cov::tree<token_base *>::const_iterator &it, std::size_t &budget)
+	{
+		if (!it.usable() || it.data() == nullptr)
+			return true;
+		if (budget == 0)
+			return false;
+		--budget;
+		token_base *token = it.data();
+		switch (token->get_type()) {
+		case token_types::value:
+			return true;
+		case token_types::id:
+			return static_cast<token_id *>(token)->get_id() != "this";
+		case token_types::signal:
+			switch (static_cast<token_signal *>(token)->get_signal()) {
+			case signal_types::add_:
+			case signal_types::sub_:
+			case signal_types::minus_:
+			case signal_types::mul_:
+			case signal_types::div_:
+			case signal_types::mod_:
+			case signal_types::pow_:
+			case signal_types::und_:
+			case signal_types::abo_:
+			case signal_types::ueq_:
+			case signal_types::aeq_:
+			case signal_types::equ_:
+			case signal_types::neq_:
+			case signal_types::and_:
+			case signal_types::or_:
+			case signal_types::not_:
+			case signal_types::choice_:
+			case signal_types::pair_:
+				return is_inlinable_expr(it.left(), budget) && is_inlinable_expr(it.right(), budget);
+			default:
+				return false;
+			}
+		default:
+			return false;
+		}
+	}
+
+	static std::size_t count_uses(const cov::tree<token_base *>::const_iterator &it, const std::string &name)
+	{
+		if (!it.usable() || it.data() == nullptr)
+			return 0;
+		if (it.data()->get_type() == token_types::id && static_cast<token_id *>(it.data())->get_id() == name)
+			return 1;
+		return count_uses(it.left(), name) + count_uses(it.right(), name);
+	}
+
+	static void substitute_args(cov::tree<token_base *> &tree, cov::tree<token_base *>::iterator it,
+	                            const std::vector<std::string> &params, std::deque<cov::tree<token_base *>> &args)
+	{
+		if (!it.usable() || it.data() == nullptr)
+			return;
+		if (it.data()->get_type() == token_types::id) {
+			const std::string &id = static_cast<token_id *>(it.data())->get_id();
+			for (std::size_t i = 0; i < params.size(); ++i) {
+				if (params[i] == id) {
+					tree.merge(it, args[i]);
+					return;
+				}
+			}
+			return;
+		}
+		substitute_args(tree, it.left(), params, args);
+		substitute_args(tree, it.right(), params, args);
+	}
+
+	const cov::tree<token_base *> *function::get_inline_body() const
+	{
+		if (!mInlineChecked) {
+			mInlineChecked = true;
+			const statement_return *ret = nullptr;
+			if (mBody.size() == 1)
+				ret = dynamic_cast<const statement_return *>(mBody.front());
+			std::size_t budget = 32;
+			if (ret != nullptr && is_inlinable_expr(ret->get_tree().root(), budget))
+				mInlineBody = &ret->get_tree();
+		}
+		return mInlineBody;
+	}
+
+	cov::tree<token_base *> function::inline_call(std::deque<cov::tree<token_base *>> &args) const
+	{
+		const cov::tree<token_base *> *body = get_inline_body();
+		if (body == nullptr || args.size() != mArgs.size())
+			return cov::tree<token_base *>();
+		for (std::size_t i = 0; i < args.size(); ++i) {
+			std::size_t budget = 32;
+			if (!is_inlinable_expr(args[i].root(), budget))
+				return cov::tree<token_base *>();
+			// A computed argument is evaluated once by a call, so it may
+			// only take the place of a parameter that is used once.
+			token_base *arg = args[i].root().data();
+			bool trivial = arg != nullptr && (arg->get_type() == token_types::id || arg->get_type() == token_types::value);
+			if (!trivial && count_uses(body->root(), mArgs[i]) > 1)
+				return cov::tree<token_base *>();
+		}
+		cov::tree<token_base *> expr(*body);
+		substitute_args(expr, expr.root(), mArgs, args);
+		return expr;
+	}
+
 	var struct_builder::operator()()
 	{
 		scope_guard scope(mContext);
@@ -94,7 +213,7 @@ namespace cs {
 		using namespace hexagon::assembly_writer;
 
 		context -> instance -> generate_code_from_expr(mTree.root(), builder);
-		builder.get_current().Write(BytecodeOp("Pop"));
+		builder.get_current().Write(BytecodeOp(Opcode::Pop));
 	}
 
 	void statement_involve::run()
@@ -106,6 +225,69 @@ namespace cs {
 			throw syntax_error("Only support involve namespace.");
 	}
 
+	// Finds the extension an expression like `system` or `system.console`
+	// refers to while compiling, or returns nullptr.
+	static name_space_t resolve_extension(const cov::tree<token_base *>::iterator &it, function_builder& builder) {
+		token_base *token = it.data();
+		if(token == nullptr) {
+			return nullptr;
+		}
+		if(token -> get_type() == token_types::id) {
+			auto& extensions = builder.root().extensions;
+			auto ext = extensions.find(static_cast<token_id *>(token) -> get_id());
+			return ext == extensions.end() ? nullptr : ext -> second;
+		}
+		if(token -> get_type() == token_types::signal && static_cast<token_signal *>(token) -> get_signal() == signal_types::dot_) {
+			name_space_t parent = resolve_extension(it.left(), builder);
+			token_base *member = it.right().data();
+			if(parent == nullptr || member == nullptr || member -> get_type() != token_types::id) {
+				return nullptr;
+			}
+			domain_t domain = parent -> get_domain();
+			auto child = domain -> find(static_cast<token_id *>(member) -> get_id());
+			if(child == domain -> end() || child -> second.type() != typeid(name_space_t)) {
+				return nullptr;
+			}
+			return child -> second.const_val<name_space_t>();
+		}
+		return nullptr;
+	}
+
+	void statement_involve::generate_code(function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		// Members are copied one by one, so their names must be known while
+		// compiling: the namespace is either defined earlier in the program
+		// or an extension.
+		std::vector<std::string> names;
+		token_base *ns = mTree.root().data();
+		auto& members = builder.root().namespace_members;
+		auto it = ns != nullptr && ns -> get_type() == token_types::id ? members.find(static_cast<token_id *>(ns) -> get_id()) : members.end();
+		if(it != members.end()) {
+			names = it -> second;
+		} else {
+			name_space_t ext = resolve_extension(mTree.root(), builder);
+			if(ext == nullptr) {
+				throw syntax_error("Only support involve namespace.");
+			}
+			for(auto& member : *ext -> get_domain()) {
+				names.push_back(member.first);
+			}
+			std::sort(names.begin(), names.end());
+		}
+
+		int ns_local = builder.anonymous_local();
+		context -> instance -> generate_code_from_expr(mTree.root(), builder);
+		builder.get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(ns_local)));
+		for(auto& name : names) {
+			builder.get_current()
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String(name)))
+				.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(ns_local)))
+				.Write(BytecodeOp(Opcode::GetField));
+			builder.write_bind_name(name);
+		}
+	}
+
 	void statement_var::run()
 	{
 		context->instance->storage.add_var(mDvp.id, copy(context->instance->parse_expr(mDvp.expr.root())));
@@ -115,7 +297,7 @@ namespace cs {
 		using namespace hexagon::assembly_writer;
 
 		context -> instance -> generate_code_from_expr(mDvp.expr.root(), builder);
-		builder.get_current().Write(BytecodeOp("SetLocal", Operand::I64(builder.map_local(mDvp.id))));
+		builder.get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(builder.map_local(mDvp.id))));
 	}
 
 	void statement_break::run()
@@ -126,7 +308,7 @@ namespace cs {
 	void statement_break::generate_code(function_builder& builder) {
 		using namespace hexagon::assembly_writer;
 		int break_target = builder.get_loop_control_info().second;
-		builder.get_current().Write(BytecodeOp("Branch", Operand::I64(break_target)));
+		builder.get_current().Write(BytecodeOp(Opcode::Branch, Operand::I64(break_target)));
 		builder.terminate_current();
 	}
 
@@ -138,7 +320,7 @@ namespace cs {
 	void statement_continue::generate_code(function_builder& builder) {
 		using namespace hexagon::assembly_writer;
 		int continue_target = builder.get_loop_control_info().first;
-		builder.get_current().Write(BytecodeOp("Branch", Operand::I64(continue_target)));
+		builder.get_current().Write(BytecodeOp(Opcode::Branch, Operand::I64(continue_target)));
 		builder.terminate_current();
 	}
 
@@ -163,6 +345,14 @@ namespace cs {
 		}
 	}
 
+	void statement_block::generate_code(function_builder& builder) {
+		builder_var_scope var_scope(&builder);
+
+		for(auto& stmt : mBlock) {
+			stmt -> generate_code(builder);
+		}
+	}
+
 	void statement_namespace::run()
 	{
 		context->instance->storage.add_var(this->mName,
@@ -188,6 +378,56 @@ namespace cs {
 		}())));
 	}
 
+	// Locals of the innermost scope ordered by slot, i.e. by definition.
+	static std::vector<std::pair<int, std::string>> scope_members(const function_builder& builder) {
+		std::vector<std::pair<int, std::string>> members;
+		for(auto& local : builder.vars.back().locals) {
+			members.push_back(std::make_pair(local.second, local.first));
+		}
+		std::sort(members.begin(), members.end());
+		return members;
+	}
+
+	void statement_namespace::generate_code(function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		// The namespace is an object whose prototype is the current `this`.
+		// Its functions are methods, so they find each other through it.
+		int ns_local = builder.anonymous_local();
+		builder.write_new_object_from_this();
+		builder.get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(ns_local)));
+
+		std::vector<std::pair<int, std::string>> members;
+		{
+			builder_var_scope var_scope(&builder);
+
+			for(auto& stmt : mBlock) {
+				if(stmt -> get_type() == statement_types::function_) {
+					statement_function *fn = static_cast<statement_function *>(stmt);
+					fn -> generate_method(builder);
+					builder.get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(builder.map_local(fn -> get_name()))));
+				} else {
+					stmt -> generate_code(builder);
+				}
+			}
+			members = scope_members(builder);
+		}
+
+		std::vector<std::string>& names = builder.root().namespace_members[mName];
+		names.clear();
+		for(auto& member : members) {
+			builder.get_current()
+				.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(member.first)))
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String(member.second)))
+				.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(ns_local)))
+				.Write(BytecodeOp(Opcode::SetField));
+			names.push_back(member.second);
+		}
+
+		builder.get_current().Write(BytecodeOp(Opcode::GetLocal, Operand::I64(ns_local)));
+		builder.write_bind_name(mName);
+	}
+
 	void statement_if::run()
 	{
 		if (context->instance->parse_expr(mTree.root()).const_val<boolean>()) {
@@ -230,14 +470,14 @@ namespace cs {
 
 		int endBlockId = builder.current_id();
 
-		tBlock.Write(BytecodeOp("CastToBool"))
+		tBlock.Write(BytecodeOp(Opcode::CastToBool))
 			.Write(BytecodeOp(
-				"ConditionalBranch",
+				Opcode::ConditionalBranch,
 				Operand::I64(bodyBlockBeginId),
 				Operand::I64(endBlockId)
 			));
 
-		bodyBlockEnd.Write(BytecodeOp("Branch", Operand::I64(endBlockId)));
+		bodyBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
 	}
 
 	void statement_ifelse::run()
@@ -311,15 +551,15 @@ namespace cs {
 
 		int endBlockId = builder.current_id();
 
-		tBlock.Write(BytecodeOp("CastToBool"))
+		tBlock.Write(BytecodeOp(Opcode::CastToBool))
 			.Write(BytecodeOp(
-				"ConditionalBranch",
+				Opcode::ConditionalBranch,
 				Operand::I64(ifBlockBeginId),
 				Operand::I64(elseBlockBeginId)
 			));
 
-		ifBlockEnd.Write(BytecodeOp("Branch", Operand::I64(endBlockId)));
-		elseBlockEnd.Write(BytecodeOp("Branch", Operand::I64(endBlockId)));
+		ifBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
+		elseBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
 	}
 
 	void statement_switch::run()
@@ -331,6 +571,96 @@ namespace cs {
 			mDefault->run();
 	}
 
+	void statement_switch::generate_code(function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		// Number the cases in a fixed order, so the generated code does not
+		// depend on hash order.
+		std::vector<std::pair<var, statement_block *>> cases(mCases.begin(), mCases.end());
+		std::sort(cases.begin(), cases.end(), [](const std::pair<var, statement_block *>& a, const std::pair<var, statement_block *>& b) {
+			int order = std::strcmp(a.first.type().name(), b.first.type().name());
+			return order != 0 ? order < 0 : a.first.to_string() < b.first.to_string();
+		});
+		std::vector<var> keys;
+		for(auto& c : cases) {
+			keys.push_back(c.first);
+		}
+
+		// Look up the index of the case to run once, instead of comparing
+		// the key against every case.
+		std::string table_id = cs_impl::unique_id::random_string(16);
+		builder.external_vars.insert(std::make_pair(table_id, var::make<switch_table>(keys)));
+
+		context -> instance -> generate_code_from_expr(mTree.root(), builder);
+		builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String(table_id)));
+		builder.write_get_from_global_registry();
+		int index_local = builder.anonymous_local();
+		builder.get_current()
+			.Write(BytecodeOp(Opcode::LoadNull))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("cs_switch_index")))
+			.Write(BytecodeOp(Opcode::GetStatic))
+			.Write(BytecodeOp(Opcode::Call, Operand::I64(2)))
+			.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(index_local)));
+
+		// Binary search over the index, -1 being the default case. Leaves
+		// only jump to their case; the jumps are threaded away when the
+		// function is built.
+		std::vector<std::pair<BasicBlockWriter *, long long>> leaves;
+		std::function<void (long long, long long)> dispatch = [&](long long lo, long long hi) {
+			if(lo == hi) {
+				leaves.push_back(std::make_pair(&builder.get_current(), lo));
+				builder.terminate_current();
+				return;
+			}
+			long long mid = lo + (hi - lo + 1) / 2;
+			auto& testBlock = builder.get_current();
+			testBlock
+				.Write(BytecodeOp(Opcode::LoadInt, Operand::I64(mid)))
+				.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(index_local)))
+				.Write(BytecodeOp(Opcode::TestLt));
+			builder.terminate_current();
+			int lowBlockId = builder.current_id();
+			dispatch(lo, mid - 1);
+			int highBlockId = builder.current_id();
+			dispatch(mid, hi);
+			testBlock.Write(BytecodeOp(
+				Opcode::ConditionalBranch,
+				Operand::I64(lowBlockId),
+				Operand::I64(highBlockId)
+			));
+		};
+		dispatch(-1, (long long) cases.size() - 1);
+
+		std::vector<int> targets;
+		std::vector<BasicBlockWriter *> bodyEnds;
+		auto generate_case = [&](statement_block *block) {
+			targets.push_back(builder.current_id());
+			block -> generate_code(builder);
+			bodyEnds.push_back(&builder.get_current());
+			builder.terminate_current();
+		};
+		for(auto& c : cases) {
+			generate_case(c.second);
+		}
+		if(mDefault != nullptr) {
+			generate_case(mDefault);
+		}
+
+		int endBlockId = builder.current_id();
+		for(auto& leaf : leaves) {
+			int target = endBlockId;
+			if(leaf.second >= 0) {
+				target = targets[leaf.second];
+			} else if(mDefault != nullptr) {
+				target = targets.back();
+			}
+			leaf.first -> Write(BytecodeOp(Opcode::Branch, Operand::I64(target)));
+		}
+		for(auto& bodyEnd : bodyEnds) {
+			bodyEnd -> Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
+		}
+	}
+
 	void statement_while::run()
 	{
 		if (context->instance->break_block)
@@ -340,6 +670,7 @@ namespace cs {
 		scope_guard scope(context);
 		while (context->instance->parse_expr(mTree.root()).const_val<boolean>()) {
 			scope.clear();
+			++context->instance->loop_back_edges;
 			for (auto &ptr:mBlock) {
 				try {
 					ptr->run();
@@ -384,7 +715,7 @@ namespace cs {
 		builder.terminate_current(); // branch deferred
 
 		// Complete the deferred branch
-		prevBlock.Write(BytecodeOp("Branch", Operand::I64(checkBlockId)));
+		prevBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(checkBlockId)));
 
 		// We do not know the id of break target block yet
 		// So we use a intermediate block to jump to it
@@ -404,19 +735,19 @@ namespace cs {
 
 		// Codegen for statements may leave the current basic block
 		auto& bodyBlockEnd = builder.get_current();
-		bodyBlockEnd.Write(BytecodeOp("Branch", Operand::I64(checkBlockId)));
+		bodyBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(checkBlockId)));
 		builder.terminate_current();
 
 		// We are now in the block after the loop body.
 		int endBlockId = builder.current_id();
 
 		// Complete the deferred branch
-		breakBlock.Write(BytecodeOp("Branch", Operand::I64(endBlockId)));
+		breakBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
 
 		// Complete the deferred branch
-		checkBlock.Write(BytecodeOp("CastToBool"))
+		checkBlock.Write(BytecodeOp(Opcode::CastToBool))
 			.Write(BytecodeOp(
-				"ConditionalBranch",
+				Opcode::ConditionalBranch,
 				Operand::I64(bodyBlockBeginId),
 				Operand::I64(endBlockId)
 			));
@@ -431,6 +762,7 @@ namespace cs {
 		scope_guard scope(context);
 		do {
 			scope.clear();
+			++context->instance->loop_back_edges;
 			for (auto &ptr:mBlock) {
 				try {
 					ptr->run();
@@ -475,7 +807,7 @@ namespace cs {
 		builder.terminate_current(); // branch deferred
 
 		// Complete the deferred branch
-		prevBlock.Write(BytecodeOp("Branch", Operand::I64(initBlockId)));
+		prevBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(initBlockId)));
 
 		// We do not know the id of break target block yet
 		// So we use a intermediate block to jump to it
@@ -509,17 +841,17 @@ namespace cs {
 		// Complete the deferred branch
 		if(mExpr) {
 			bodyBlockEnd
-				.Write(BytecodeOp("CastToBool"))
-				.Write(BytecodeOp("ConditionalBranch", Operand::I64(endBlockId), Operand::I64(initBlockId)));
+				.Write(BytecodeOp(Opcode::CastToBool))
+				.Write(BytecodeOp(Opcode::ConditionalBranch, Operand::I64(endBlockId), Operand::I64(initBlockId)));
 		} else {
-			bodyBlockEnd.Write(BytecodeOp("Branch", Operand::I64(initBlockId)));
+			bodyBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(initBlockId)));
 		}
 
 		// Complete the deferred branch
-		breakBlock.Write(BytecodeOp("Branch", Operand::I64(endBlockId)));
+		breakBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
 
 		// Complete the deferred branch
-		initBlock.Write(BytecodeOp("Branch", Operand::I64(bodyBlockBeginId)));
+		initBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(bodyBlockBeginId)));
 	}
 
 	void statement_for::run()
@@ -532,6 +864,7 @@ namespace cs {
 		var val = copy(context->instance->context->instance->parse_expr(mDvp.expr.root()));
 		while (val.const_val<number>() <= context->instance->parse_expr(mEnd.root()).const_val<number>()) {
 			scope.clear();
+			++context->instance->loop_back_edges;
 			context->instance->storage.add_var(mDvp.id, val);
 			for (auto &ptr:mBlock) {
 				try {
@@ -572,7 +905,7 @@ namespace cs {
 
 		// The initialization step
 		context -> instance -> generate_code_from_expr(mDvp.expr.root(), builder);
-		prevBlock.Write(BytecodeOp("SetLocal", Operand::I64(builder.map_local(mDvp.id))));
+		prevBlock.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(builder.map_local(mDvp.id))));
 
 		builder.terminate_current(); // branch deferred
 
@@ -583,13 +916,13 @@ namespace cs {
 		// Codegen for expressions cannot leave the current basic block
 		context -> instance -> generate_code_from_expr(mEnd.root(), builder);
 		checkBlock
-			.Write(BytecodeOp("GetLocal", Operand::I64(builder.map_local(mDvp.id))))
-			.Write(BytecodeOp("TestLe"));
+			.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(builder.map_local(mDvp.id))))
+			.Write(BytecodeOp(Opcode::TestLe));
 
 		builder.terminate_current(); // branch deferred
 
 		// Complete the deferred branch
-		prevBlock.Write(BytecodeOp("Branch", Operand::I64(checkBlockId)));
+		prevBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(checkBlockId)));
 
 		// We do not know the id of break target block yet
 		// So we use a intermediate block to jump to it
@@ -601,10 +934,10 @@ namespace cs {
 		int stepBlockId = builder.current_id();
 		context -> instance -> generate_code_from_expr(mStep.root(), builder);
 		stepBlock
-			.Write(BytecodeOp("GetLocal", Operand::I64(builder.map_local(mDvp.id))))
-			.Write(BytecodeOp("Add"))
-			.Write(BytecodeOp("SetLocal", Operand::I64(builder.map_local(mDvp.id))));
-		stepBlock.Write(BytecodeOp("Branch", Operand::I64(checkBlockId)));
+			.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(builder.map_local(mDvp.id))))
+			.Write(BytecodeOp(Opcode::Add))
+			.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(builder.map_local(mDvp.id))));
+		stepBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(checkBlockId)));
 		builder.terminate_current();
 
 		// Now we can build the loop body
@@ -619,25 +952,44 @@ namespace cs {
 
 		// Codegen for statements may leave the current basic block
 		auto& bodyBlockEnd = builder.get_current();
-		bodyBlockEnd.Write(BytecodeOp("Branch", Operand::I64(stepBlockId)));
+		bodyBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(stepBlockId)));
 		builder.terminate_current();
 
 		// We are now in the block after the loop body.
 		int endBlockId = builder.current_id();
 
 		// Complete the deferred branch
-		breakBlock.Write(BytecodeOp("Branch", Operand::I64(endBlockId)));
+		breakBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
 
 		// Complete the deferred branch
-		checkBlock.Write(BytecodeOp("CastToBool"))
+		checkBlock.Write(BytecodeOp(Opcode::CastToBool))
 			.Write(BytecodeOp(
-				"ConditionalBranch",
+				Opcode::ConditionalBranch,
 				Operand::I64(bodyBlockBeginId),
 				Operand::I64(endBlockId)
 			));
 	}
 
-	template<typename T, typename X>
+	// The value foreach binds to its iterator for one element.
+	template<typename X>
+	inline const X &foreach_element(const X &element)
+	{
+		return element;
+	}
+
+	inline pair foreach_element(const hash_map::value_type &entry)
+	{
+		return pair(entry.first, entry.second);
+	}
+
+	// Entries of a string_map keep their key as a std::string, so the pair
+	// is built from the entry here rather than by converting it in the loop.
+	inline pair foreach_element(const string_map::value_type &entry)
+	{
+		return pair(var(entry.first), entry.second);
+	}
+
+	template<typename T>
 	void foreach_helper(context_t context, const string &iterator, const var &obj, std::deque<statement_base *> &body)
 	{
 		if (obj.const_val<T>().empty())
@@ -647,9 +999,10 @@ namespace cs {
 		if (context->instance->continue_block)
 			context->instance->continue_block = false;
 		scope_guard scope(context);
-		for (const X &it:obj.const_val<T>()) {
+		for (const auto &it:obj.const_val<T>()) {
 			scope.clear();
-			context->instance->storage.add_var(iterator, it);
+			++context->instance->loop_back_edges;
+			context->instance->storage.add_var(iterator, foreach_element(it));
 			for (auto &ptr:body) {
 				try {
 					ptr->run();
@@ -682,13 +1035,15 @@ namespace cs {
 	{
 		const var &obj = context->instance->parse_expr(this->mObj.root());
 		if (obj.type() == typeid(string))
-			foreach_helper<string, char>(context, this->mIt, obj, this->mBlock);
+			foreach_helper<string>(context, this->mIt, obj, this->mBlock);
 		else if (obj.type() == typeid(list))
-			foreach_helper<list, var>(context, this->mIt, obj, this->mBlock);
+			foreach_helper<list>(context, this->mIt, obj, this->mBlock);
 		else if (obj.type() == typeid(array))
-			foreach_helper<array, var>(context, this->mIt, obj, this->mBlock);
+			foreach_helper<array>(context, this->mIt, obj, this->mBlock);
 		else if (obj.type() == typeid(hash_map))
-			foreach_helper<hash_map, pair>(context, this->mIt, obj, this->mBlock);
+			foreach_helper<hash_map>(context, this->mIt, obj, this->mBlock);
+		else if (obj.type() == typeid(string_map))
+			foreach_helper<string_map>(context, this->mIt, obj, this->mBlock);
 		else
 			throw syntax_error("Unsupported type(foreach)");
 	}
@@ -696,6 +1051,8 @@ namespace cs {
 	void statement_foreach::generate_code(function_builder& builder) {
 		using namespace hexagon::assembly_writer;
 
+		builder.check_throw_free();
+
 		builder_var_scope var_scope(&builder);
 
 		// The block before loop
@@ -704,11 +1061,11 @@ namespace cs {
 		// The initialization step
 		context -> instance -> generate_code_from_expr(mObj.root(), builder);
 		prevBlock
-			.Write(BytecodeOp("LoadString", Operand::String("__iterate__")))
-			.Write(BytecodeOp("LoadNull"))
-			.Write(BytecodeOp("Rotate3"))
-			.Write(BytecodeOp("CallField", Operand::I64(0)))
-			.Write(BytecodeOp("SetLocal", Operand::I64(builder.map_local(mIt))));
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("__iterate__")))
+			.Write(BytecodeOp(Opcode::LoadNull))
+			.Write(BytecodeOp(Opcode::Rotate3))
+			.Write(BytecodeOp(Opcode::CallField, Operand::I64(0)))
+			.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(builder.map_local(mIt))));
 
 		builder.terminate_current(); // branch deferred
 
@@ -717,15 +1074,15 @@ namespace cs {
 		int checkBlockId = builder.current_id();
 
 		checkBlock
-			.Write(BytecodeOp("LoadString", Operand::String("__has_next__")))
-			.Write(BytecodeOp("LoadNull"))
-			.Write(BytecodeOp("GetLocal", Operand::I64(builder.map_local(mIt))))
-			.Write(BytecodeOp("CallField", Operand::I64(0)));
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("__has_next__")))
+			.Write(BytecodeOp(Opcode::LoadNull))
+			.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(builder.map_local(mIt))))
+			.Write(BytecodeOp(Opcode::CallField, Operand::I64(0)));
 
 		builder.terminate_current(); // branch deferred
 
 		// Complete the deferred branch
-		prevBlock.Write(BytecodeOp("Branch", Operand::I64(checkBlockId)));
+		prevBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(checkBlockId)));
 
 		// We do not know the id of break target block yet
 		// So we use a intermediate block to jump to it
@@ -736,12 +1093,12 @@ namespace cs {
 		auto& stepBlock = builder.get_current();
 		int stepBlockId = builder.current_id();
 		stepBlock
-			.Write(BytecodeOp("LoadString", Operand::String("__next__")))
-			.Write(BytecodeOp("LoadNull"))
-			.Write(BytecodeOp("GetLocal", Operand::I64(builder.map_local(mIt))))
-			.Write(BytecodeOp("CallField", Operand::I64(0)))
-			.Write(BytecodeOp("Pop"));
-		stepBlock.Write(BytecodeOp("Branch", Operand::I64(checkBlockId)));
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("__next__")))
+			.Write(BytecodeOp(Opcode::LoadNull))
+			.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(builder.map_local(mIt))))
+			.Write(BytecodeOp(Opcode::CallField, Operand::I64(0)))
+			.Write(BytecodeOp(Opcode::Pop));
+		stepBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(checkBlockId)));
 		builder.terminate_current();
 
 		// Now we can build the loop body
@@ -756,19 +1113,19 @@ namespace cs {
 
 		// Codegen for statements may leave the current basic block
 		auto& bodyBlockEnd = builder.get_current();
-		bodyBlockEnd.Write(BytecodeOp("Branch", Operand::I64(stepBlockId)));
+		bodyBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(stepBlockId)));
 		builder.terminate_current();
 
 		// We are now in the block after the loop body.
 		int endBlockId = builder.current_id();
 
 		// Complete the deferred branch
-		breakBlock.Write(BytecodeOp("Branch", Operand::I64(endBlockId)));
+		breakBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
 
 		// Complete the deferred branch
-		checkBlock.Write(BytecodeOp("CastToBool"))
+		checkBlock.Write(BytecodeOp(Opcode::CastToBool))
 			.Write(BytecodeOp(
-				"ConditionalBranch",
+				Opcode::ConditionalBranch,
 				Operand::I64(bodyBlockBeginId),
 				Operand::I64(endBlockId)
 			));
@@ -779,6 +1136,58 @@ namespace cs {
 		context->instance->storage.add_struct(this->mName, this->mBuilder);
 	}
 
+	void statement_struct::generate_code(function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		// The struct is an object holding the methods and `__new__`, with the
+		// current `this` as its prototype. `new` passes it as `this` to the
+		// constructor, which makes it the prototype of every instance.
+		builder.write_new_object_from_this();
+
+		const std::string ctor_name = cs_impl::unique_id::random_string(16);
+		function_builder& ctor = builder.create_child(ctor_name);
+		ctor.bind_this = false;
+		int inst = ctor.anonymous_local();
+		ctor.write_new_object_from_this();
+		ctor.get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(inst)));
+
+		for(auto& stmt : mBuilder.get_method()) {
+			if(stmt -> get_type() == statement_types::function_) {
+				statement_function *fn = static_cast<statement_function *>(stmt);
+				builder.get_current().Write(BytecodeOp(Opcode::Dup));
+				fn -> generate_method(builder);
+				builder.get_current()
+					.Write(BytecodeOp(Opcode::LoadString, Operand::String(fn -> get_name())))
+					.Write(BytecodeOp(Opcode::Rotate3))
+					.Write(BytecodeOp(Opcode::SetField));
+			} else {
+				stmt -> generate_code(ctor);
+			}
+		}
+
+		for(auto& member : scope_members(ctor)) {
+			ctor.get_current()
+				.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(member.first)))
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String(member.second)))
+				.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(inst)))
+				.Write(BytecodeOp(Opcode::SetField));
+		}
+		ctor.get_current()
+			.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(inst)))
+			.Write(BytecodeOp(Opcode::Return));
+
+		builder.get_current()
+			.Write(BytecodeOp(Opcode::Dup))
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String(ctor_name)));
+		builder.write_get_from_global_registry();
+		builder.get_current()
+			.Write(BytecodeOp(Opcode::LoadString, Operand::String("__new__")))
+			.Write(BytecodeOp(Opcode::Rotate3))
+			.Write(BytecodeOp(Opcode::SetField));
+
+		builder.write_bind_name(mName);
+	}
+
 	void statement_function::run()
 	{
 		if (this->mIsMemFn)
@@ -799,12 +1208,45 @@ namespace cs {
 		for(auto& stmt : mFunc.mBody) {
 			stmt -> generate_code(new_builder);
 		}
-		new_builder.get_current().Write(BytecodeOp("LoadNull"));
-		new_builder.get_current().Write(BytecodeOp("Return"));
+		new_builder.get_current().Write(BytecodeOp(Opcode::LoadNull));
+		new_builder.get_current().Write(BytecodeOp(Opcode::Return));
 
-		old_builder.get_current().Write(BytecodeOp("LoadString", Operand::String(mName)));
+		old_builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String(mName)));
 		old_builder.write_get_from_global_registry();
-		old_builder.get_current().Write(BytecodeOp("SetLocal", Operand::I64(old_builder.map_local(mName))));
+		int local_id = old_builder.map_local(mName);
+		old_builder.get_current().Write(BytecodeOp(Opcode::SetLocal, Operand::I64(local_id)));
+
+		// Functions compiled under the same name elsewhere share a registry
+		// entry, so which one a call reaches is not known.
+		auto& inline_functions = old_builder.root().inline_functions;
+		if(old_builder.parent == nullptr && inline_functions.count(mName) == 0) {
+			inline_functions.emplace(mName, std::make_pair(&mFunc, local_id));
+		} else {
+			inline_functions[mName] = std::make_pair(nullptr, -1);
+		}
+	}
+
+	void statement_function::generate_method(function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		// Methods of different structs may share a name, so the registry
+		// key is unique instead.
+		const std::string method_name = cs_impl::unique_id::random_string(16);
+		function_builder& new_builder = builder.create_child(method_name);
+		new_builder.bind_this = false;
+		// `this` is the object the method is called on, not an argument.
+		for(std::size_t i = mIsMemFn ? 1 : 0; i < mFunc.mArgs.size(); i++) {
+			new_builder.add_argument(mFunc.mArgs[i]);
+		}
+		new_builder.map_arg_names();
+		for(auto& stmt : mFunc.mBody) {
+			stmt -> generate_code(new_builder);
+		}
+		new_builder.get_current().Write(BytecodeOp(Opcode::LoadNull));
+		new_builder.get_current().Write(BytecodeOp(Opcode::Return));
+
+		builder.get_current().Write(BytecodeOp(Opcode::LoadString, Operand::String(method_name)));
+		builder.write_get_from_global_registry();
 	}
 
 	void statement_return::run()
@@ -819,7 +1261,7 @@ namespace cs {
 		using namespace hexagon::assembly_writer;
 
 		context -> instance -> generate_code_from_expr(mTree.root(), builder);
-		builder.get_current().Write(BytecodeOp("Return"));
+		builder.get_current().Write(BytecodeOp(Opcode::Return));
 		builder.terminate_current();
 	}
 
@@ -863,6 +1305,60 @@ namespace cs {
 		}
 	}
 
+	void statement_try::generate_code(function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		// Throw statements in the try body jump here with the exception
+		// stored in the catch variable, so the try body itself runs
+		// without any extra work. Nothing else in the body may throw, see
+		// function_builder::check_throw_free.
+		builder.root().uses_exceptions = true;
+		int exception_local = builder.anonymous_local();
+
+		auto& prevBlock = builder.get_current();
+		builder.terminate_current(); // branch deferred
+
+		// We do not know the id of the catch block yet
+		// So we use a intermediate block to jump to it
+		auto& catchEntryBlock = builder.get_current();
+		int catchEntryBlockId = builder.current_id();
+		builder.terminate_current(); // branch deferred
+
+		int tryBlockBeginId = builder.current_id();
+		prevBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(tryBlockBeginId)));
+
+		builder.push_try_handler(catchEntryBlockId, exception_local);
+		{
+			builder_var_scope var_scope(&builder);
+			for(auto& stmt : mTryBody) {
+				stmt -> generate_code(builder);
+			}
+		}
+		builder.pop_try_handler();
+
+		auto& tryBlockEnd = builder.get_current();
+		builder.terminate_current(); // branch deferred
+
+		int catchBlockId = builder.current_id();
+		catchEntryBlock.Write(BytecodeOp(Opcode::Branch, Operand::I64(catchBlockId)));
+		{
+			builder_var_scope var_scope(&builder);
+			builder.get_current()
+				.Write(BytecodeOp(Opcode::GetLocal, Operand::I64(exception_local)))
+				.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(builder.map_local(mName))));
+			for(auto& stmt : mCatchBody) {
+				stmt -> generate_code(builder);
+			}
+		}
+
+		auto& catchBlockEnd = builder.get_current();
+		builder.terminate_current();
+
+		int endBlockId = builder.current_id();
+		tryBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
+		catchBlockEnd.Write(BytecodeOp(Opcode::Branch, Operand::I64(endBlockId)));
+	}
+
 	void statement_throw::run()
 	{
 		var e = context->instance->parse_expr(this->mTree.root());
@@ -871,4 +1367,35 @@ namespace cs {
 		else
 			throw e.const_val<lang_error>();
 	}
+
+	void statement_throw::generate_code(function_builder& builder) {
+		using namespace hexagon::assembly_writer;
+
+		builder.root().uses_exceptions = true;
+
+		context -> instance -> generate_code_from_expr(mTree.root(), builder);
+
+		std::pair<int, int> handler;
+		if(builder.get_try_handler(handler)) {
+			// Caught in this function: check the value is an exception and
+			// go straight to the catch block.
+			builder.get_current()
+				.Write(BytecodeOp(Opcode::LoadNull))
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String("cs_check_exception")))
+				.Write(BytecodeOp(Opcode::GetStatic))
+				.Write(BytecodeOp(Opcode::Call, Operand::I64(1)))
+				.Write(BytecodeOp(Opcode::SetLocal, Operand::I64(handler.second)))
+				.Write(BytecodeOp(Opcode::Branch, Operand::I64(handler.first)));
+		} else {
+			// The HVM cannot unwind, so anything else leaves the VM as an
+			// error raised by a native function. cs_throw never returns.
+			builder.get_current()
+				.Write(BytecodeOp(Opcode::LoadNull))
+				.Write(BytecodeOp(Opcode::LoadString, Operand::String("cs_throw")))
+				.Write(BytecodeOp(Opcode::GetStatic))
+				.Write(BytecodeOp(Opcode::Call, Operand::I64(1)))
+				.Write(BytecodeOp(Opcode::Return));
+		}
+		builder.terminate_current();
+	}
 }
@@ -0,0 +1,64 @@
+// Checks the embedding API: compile a string once, then invoke its
+// functions repeatedly, recovering from a failed invocation with reset().
+#include "../sources/covscript.cpp"
+#include <iostream>
+
+static const char *script =
+    "var calls = 0\n"
+    "function add(a, b)\n"
+    "    ++calls\n"
+    "    return a + b\n"
+    "end\n"
+    "function fail(depth)\n"
+    "    ++calls\n"
+    "    if depth > 0\n"
+    "        return fail(depth - 1)\n"
+    "    end\n"
+    "    throw runtime.exception(\"failed\")\n"
+    "end\n"
+    "function count()\n"
+    "    return calls\n"
+    "end\n";
+
+static bool check(bool cond, const char *what)
+{
+	if (!cond)
+		std::cout << "FAILED: " << what << std::endl;
+	return cond;
+}
+
+int main()
+{
+	cs::init_ext();
+	cs::instance_type instance;
+	instance.compile_string(script);
+	instance.interpret();
+	bool ok = true;
+	cs::vector args{cs::var::make<cs::number>(1), cs::var::make<cs::number>(2)};
+	ok &= check(instance.invoke("add", args).const_val<cs::number>() == 3, "add");
+	bool thrown = false;
+	try {
+		cs::vector depth{cs::var::make<cs::number>(3)};
+		instance.invoke("fail", depth);
+	}
+	catch (const cs::fatal_error &e) {
+		thrown = std::string(e.what()).find("failed") != std::string::npos;
+	}
+	ok &= check(thrown, "fail throws");
+	instance.reset();
+	ok &= check(instance.storage.get_domain() == instance.storage.get_global(), "reset leaves only the global domain");
+	cs::vector none;
+	ok &= check(instance.invoke("count", none).const_val<cs::number>() == 5, "globals survive reset");
+	ok &= check(instance.invoke("add", args).const_val<cs::number>() == 3, "add after reset");
+	thrown = false;
+	try {
+		instance.invoke("calls", none);
+	}
+	catch (const cs::fatal_error &) {
+		thrown = true;
+	}
+	ok &= check(thrown, "invoke a variable");
+	if (ok)
+		std::cout << "OK" << std::endl;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#!/bin/bash
+# Runs every script in this directory on the HVM backend, with and
+# without backend optimization, and in tiered mode, and checks that each
+# one prints "OK". Scripts named tier_*.csc check how functions got
+# tiered, so they only run in tiered mode.
+cd "$(dirname "$0")"
+failed=0
+for f in *.csc
+do
+    case $f in
+        tier_*) modes=("--hvm-tiered") ;;
+        *) modes=("--enable-hvm" "--enable-hvm --hvm-optimize" "--hvm-tiered") ;;
+    esac
+    for flags in "${modes[@]}"
+    do
+        result=$(cs $flags $f 2>&1)
+        if [ "$result" != "OK" ]; then
+            echo "FAILED: $f ($flags)"
+            echo "$result"
+            failed=1
+        fi
+    done
+done
+if [ $failed -eq 0 ]; then
+    echo "All tests passed."
+fi
+exit $failed
@@ -0,0 +1,27 @@
+function fill(arr, n)
+    for i = 0 to n - 1
+        arr[i] = i * 2
+    end
+end
+
+function count(words)
+    var m = new hash_map
+    for i = 0 to words.size() - 1
+        if m.exist(words[i])
+            m[words[i]] += 1
+        else
+            m[words[i]] = 1
+        end
+    end
+    return m
+end
+
+var arr = {0, 0, 0, 0, 0}
+fill(arr, 5)
+arr[4] += 1
+var m = count({"a", "b", "a", "c", "a"})
+if arr[3] != 6 || arr[4] != 9 || m["a"] != 3 || m["c"] != 1
+    system.out.println("Bad elements")
+else
+    system.out.println("OK")
+end
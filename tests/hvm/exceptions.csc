@@ -0,0 +1,50 @@
+function checked_div(a, b, error)
+    var result = 0
+    try
+        if b == 0
+            throw error
+        end
+        result = a / b
+    catch e
+        result = -1
+    end
+    return result
+end
+
+function first_multiple(n, k, error)
+    var found = -1
+    try
+        for i = 1 to n
+            if i % k == 0
+                found = i
+                throw error
+            end
+        end
+    catch e
+        if e.what() != "found"
+            found = -2
+        end
+    end
+    return found
+end
+
+var division = runtime.exception("division by zero")
+var stop = runtime.exception("found")
+var inner = runtime.exception("inner")
+var caught = stop
+try
+    try
+        throw inner
+    catch e
+        caught = e
+    end
+catch e
+    caught = stop
+end
+var message = caught.what()
+
+if checked_div(6, 3, division) != 2 || checked_div(1, 0, division) != -1 || first_multiple(10, 4, stop) != 4 || first_multiple(3, 4, stop) != -1 || message != "inner"
+    system.out.println("Bad exceptions")
+else
+    system.out.println("OK")
+end
@@ -0,0 +1,17 @@
+function square(x)
+    return x * x
+end
+
+function sum_squares(n)
+    var s = 0
+    for i = 1 to n
+        s = s + square(i) + math.abs(0)
+    end
+    return s
+end
+
+if sum_squares(10) != 385
+    system.out.println("Bad sum")
+else
+    system.out.println("OK")
+end
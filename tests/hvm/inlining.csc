@@ -0,0 +1,35 @@
+function square(x)
+    return x * x
+end
+
+function affine(x, a, b)
+    return a * x + b
+end
+
+function count_up(n)
+    var calls = 0
+    var s = 0
+    for i = 1 to n
+        calls++
+        s = s + square(i) + square(calls + 1) + affine(i, 2, 5)
+    end
+    return s
+end
+
+var ok = true
+if count_up(10) != 385 + 505 + 160
+    ok = false
+end
+var k = 0
+square(k++)
+if k != 1
+    ok = false
+end
+if ([](a, b)->a * 10 + b)(4, 2) != 42
+    ok = false
+end
+if ok
+    system.out.println("OK")
+else
+    system.out.println("Value mismatch")
+end
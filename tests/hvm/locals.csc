@@ -0,0 +1,23 @@
+function scopes(n)
+    var total = 0
+    for i = 1 to n
+        if i % 2 == 0
+            var a = i * 3
+            a += 1
+            total += a
+        else
+            var b = i
+            b -= 1
+            total += b
+        end
+    end
+    var c = total
+    ++c
+    return c
+end
+
+if scopes(4) != 23
+    system.out.println("Bad locals")
+else
+    system.out.println("OK")
+end
@@ -0,0 +1,52 @@
+var ok = true
+
+var neg_int = -3
+var neg_float = -2.5
+var x = 4
+var neg_var = -x
+if neg_int + neg_float + neg_var != -9.5
+    system.out.println("Unary minus mismatch")
+    ok = false
+end
+
+var a = 1
+var b = 0
+b = a = 5
+a += 2
+a *= 3
+if a != 21 || b != 5
+    system.out.println("Local assignment mismatch")
+    ok = false
+end
+
+var i = 0
+var post = i++
+var pre = ++i
+if post != 0 || pre != 2 || i != 2
+    system.out.println("Increment mismatch")
+    ok = false
+end
+
+var obj = builtin.new_dynamic(null)
+obj.v = 10
+obj.v += 5
+obj.v -= 1
+obj.v++
+--obj.v
+if obj.v != 14
+    system.out.println("Field update mismatch")
+    ok = false
+end
+
+var arr = {1, 2, 3}
+arr[0] += 10
+arr[1] *= arr[2]
+arr[2]++
+if arr[0] != 11 || arr[1] != 6 || arr[2] != 4
+    system.out.println("Element update mismatch")
+    ok = false
+end
+
+if ok
+    system.out.println("OK")
+end
@@ -0,0 +1,56 @@
+struct counter
+    var count = 0
+    var stride = 1
+    function add()
+        this.count = this.count + this.stride
+        return this
+    end
+    function get()
+        return this.count
+    end
+end
+
+struct point
+    var first = 0
+    var second = 0
+    function sum()
+        return this.first + this.second
+    end
+end
+
+namespace geometry
+    var unit = 2
+    function square(x)
+        return x * x
+    end
+    function area(w, h)
+        return w * h * square(unit) / 4
+    end
+end
+
+function count_to(n)
+    var c = new counter
+    c.stride = 2
+    for i = 1 to n
+        c.add()
+    end
+    return c.get()
+end
+
+var p = new point
+p.first = 3
+p.second = 4
+
+var total = 0
+block
+    var inner = p.sum()
+    total = total + inner
+end
+
+using geometry
+
+if count_to(5) != 10 || p.sum() != 7 || total != 7 || geometry.area(2, 3) != 6 || square(3) != 9 || unit != 2
+    system.out.println("Bad structs")
+else
+    system.out.println("OK")
+end
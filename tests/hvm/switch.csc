@@ -0,0 +1,71 @@
+function state_name(s)
+    var name = "unknown"
+    switch s
+        case 0
+            name = "idle"
+        end
+        case 1
+            name = "running"
+        end
+        case 3
+            name = "done"
+        end
+        default
+            name = "other"
+        end
+    end
+    return name
+end
+
+function command(cmd)
+    var code = 0
+    switch cmd
+        case "start"
+            code = 1
+        end
+        case "stop"
+            code = 2
+        end
+        case 100000
+            code = 3
+        end
+    end
+    return code
+end
+
+function classify(ch)
+    switch ch
+        case 'a'
+            return 1
+        end
+        case 'b'
+            return 2
+        end
+    end
+    return 0
+end
+
+function char_or_code(k)
+    switch k
+        case 'a'
+            return 1
+        end
+        case 97
+            return 2
+        end
+    end
+    return 0
+end
+
+var result = ""
+for i = 0 to 4
+    result += state_name(i) + " "
+end
+var codes = command("start") + command("stop") * 10 + command(100000) * 100 + command("x") * 1000
+var chars = classify('a') + classify('b') * 10 + classify('c') * 100
+var kinds = char_or_code('a') + char_or_code(97) * 10 + char_or_code('b') * 100
+if result != "idle running other done other " || codes != 321 || chars != 21 || kinds != 21
+    system.out.println("Bad switch")
+else
+    system.out.println("OK")
+end
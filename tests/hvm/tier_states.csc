@@ -0,0 +1,34 @@
+function poly(x)
+    var y = x * x
+    return y + x
+end
+
+function inc(x)
+    x = x + 1
+end
+
+function guarded(x, error)
+    try
+        if x < 0
+            throw error
+        end
+    catch e
+        return 0
+    end
+    return x
+end
+
+var error = runtime.exception("negative")
+var a = 0
+var total = 0
+var i = 0
+while i < 1500
+    total = total + poly(i) + guarded(i, error)
+    inc(a)
+    i++
+end
+if a != 1500 || runtime.hvm_tier(poly) != "compiled" || runtime.hvm_tier(inc) != "unsupported" || runtime.hvm_tier(guarded) != "unsupported"
+    system.out.println("Bad tiering")
+else
+    system.out.println("OK")
+end
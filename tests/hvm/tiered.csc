@@ -0,0 +1,31 @@
+function add(a, b)
+    return a + b
+end
+
+function sum_to(n)
+    var s = 0
+    var i = 1
+    while i <= n
+        s = add(s, i)
+        i++
+    end
+    return s
+end
+
+function set_flag()
+    flag = true
+end
+
+var flag = false
+var total = 0
+var i = 0
+while i < 2000
+    total = total + sum_to(10)
+    set_flag()
+    i++
+end
+if total != 110000 || !flag
+    system.out.println("Value mismatch")
+else
+    system.out.println("OK")
+end
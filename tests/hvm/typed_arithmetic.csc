@@ -0,0 +1,20 @@
+var sum = 0
+for i = 1 to 100
+    sum = sum + i * 2 - 1
+end
+
+var x = 1.5
+var nx = -x
+var y = x * 4 / 3 - nx
+var found = false
+var k = 0
+while k < 10 && !found
+    k = k + 1
+    found = k * k > 50
+end
+
+if sum != 10000 || y != 3.5 || k != 8
+    system.out.println("Value mismatch")
+else
+    system.out.println("OK")
+end
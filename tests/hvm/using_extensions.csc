@@ -0,0 +1,7 @@
+using math
+
+if abs(sqrt(16) - 4) > 0.0001 || max(pi, e) != pi
+    system.out.println("Bad math members")
+else
+    system.out.println("OK")
+end
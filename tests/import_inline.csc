@@ -0,0 +1,11 @@
+import scale
+var expected = scale.mul(2)
+var scale_factor = 3
+function local_mul(x)
+    return x * scale_factor
+end
+if expected == 20 && local_mul(2) == 6
+    system.out.println("OK")
+else
+    system.out.println("Value mismatch")
+end
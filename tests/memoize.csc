@@ -0,0 +1,14 @@
+var calls = 0
+var fib = runtime.memoize([](n)->(++calls) > 0 && n > 1 ? fib(n - 1) + fib(n - 2) : n)
+system.out.println(fib(80))
+system.out.println(calls)
+var lookup = runtime.memoize_bounded([](a, b)->(++calls) > 0 ? a + b : 0, 2)
+calls = 0
+lookup(1, 2)
+lookup(3, 4)
+lookup(1, 2)
+lookup(5, 6)
+lookup(1, 2)
+lookup(3, 4)
+system.out.println(calls)
+system.out.println(lookup("memo", "ize"))
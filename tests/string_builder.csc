@@ -0,0 +1,20 @@
+var sb = new string_builder
+sb.reserve(64)
+for i = 1 to 5
+    sb.append(i).append(",")
+end
+system.out.println(sb.to_string())
+system.out.println(sb.size())
+system.out.println(to_string(sb) + "end")
+sb.clear()
+system.out.println(sb.empty())
+for i = 1 to 3
+    var s = "a"
+    s += i
+    s += 'c'
+    system.out.println(s)
+end
+var t = "x"
+var u = t
+t += "y"
+system.out.println(t + " " + u)
@@ -0,0 +1,25 @@
+var map = new string_map
+for i = 1 to 1000
+    map[to_string(i % 100)] += i
+end
+system.out.println("Size=" + to_string(map.size()))
+system.out.println(map["7"])
+for i = 0 to 49
+    map.erase(to_string(i))
+end
+system.out.println("Size=" + to_string(map.size()))
+system.out.println(map.exist("7"))
+system.out.println(map.exist("57"))
+for i = 1 to 5000
+    map.insert("key" + to_string(i), i)
+    map.erase("key" + to_string(i - 1))
+end
+system.out.println("Size=" + to_string(map.size()))
+system.out.println(map.at("key5000"))
+var sum = 0
+for it iterate map
+    sum += it.second()
+end
+system.out.println(sum)
+map.clear()
+system.out.println(map.empty())
@@ -0,0 +1,53 @@
+#!/bin/bash
+# Runs echo.csc in worker mode, once over stdin and once over a socket,
+# and checks the replies. Every job is answered by the same prewarmed
+# instance, so the job counter keeps counting across jobs and failures.
+cd "$(dirname "$0")"
+failed=0
+expect() {
+    if [ "$2" != "$3" ]; then
+        echo "FAILED: $1"
+        echo "expected: $2"
+        echo "got: $3"
+        failed=1
+    fi
+}
+
+result=$(printf 'a\nfail\nb\n' | cs --worker handle echo.csc 2>&1)
+expect "stdin" "$(printf '+a 1\n-Fatal Error: Uncaught exception: bad job\n+b 3')" "$result"
+
+result=$(cs --worker jobs echo.csc < /dev/null 2>&1)
+expect "entry check" 'Fatal Error: worker entry "jobs" is not a function.' "$result"
+
+socket=$(mktemp -u /tmp/cs_worker_XXXXXX)
+cs --worker handle --worker-socket "$socket" --worker-count 2 echo.csc &
+supervisor=$!
+for i in $(seq 50); do
+    [ -S "$socket" ] && break
+    sleep 0.1
+done
+result=$(python3 - "$socket" <<'PY'
+import socket, sys
+conn = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+conn.connect(sys.argv[1])
+conn.sendall(b"x\nfail\ny\n")
+conn.shutdown(socket.SHUT_WR)
+data = b""
+while True:
+    chunk = conn.recv(4096)
+    if not chunk:
+        break
+    data += chunk
+sys.stdout.write(data.decode().rstrip("\n"))
+PY
+)
+expect "socket" "$(printf '+x 1\n-Fatal Error: Uncaught exception: bad job\n+y 3')" "$result"
+workers=$(pgrep -P $supervisor)
+kill $supervisor $workers
+wait $supervisor 2>/dev/null
+rm -f "$socket"
+
+if [ $failed -eq 0 ]; then
+    echo "All tests passed."
+fi
+exit $failed
@@ -0,0 +1,9 @@
+var jobs = 0
+
+function handle(job)
+    ++jobs
+    if job == "fail"
+        throw runtime.exception("bad job")
+    end
+    return job + " " + to_string(jobs)
+end